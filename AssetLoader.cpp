@@ -0,0 +1,367 @@
+#include "AssetLoader.h"
+
+#include <wincodec.h>
+#pragma comment(lib, "windowscodecs.lib")
+
+// --------------------------------------------------------
+// Checks an image's color space metadata the same way
+// DirectXTK's WIC loader does, so textures loaded here come
+// out in the same (sRGB or linear) format as before
+// --------------------------------------------------------
+static bool HasSRGBMetadata(IWICBitmapFrameDecode* frame)
+{
+	Microsoft::WRL::ComPtr<IWICMetadataQueryReader> reader;
+	if (FAILED(frame->GetMetadataQueryReader(reader.GetAddressOf())))
+		return false;
+
+	GUID container;
+	if (FAILED(reader->GetContainerFormat(&container)))
+		return false;
+
+	bool sRGB = false;
+	PROPVARIANT value;
+	PropVariantInit(&value);
+
+	if (container == GUID_ContainerFormatPng)
+	{
+		// PNGs are sRGB if they have an sRGB chunk or a 1/2.2 gamma chunk
+		if (SUCCEEDED(reader->GetMetadataByName(L"/sRGB/RenderingIntent", &value)) && value.vt == VT_UI1)
+			sRGB = true;
+		else if (SUCCEEDED(reader->GetMetadataByName(L"/gAMA/ImageGamma", &value)) && value.vt == VT_UI4)
+			sRGB = (value.uintVal == 45455);
+	}
+	else if (SUCCEEDED(reader->GetMetadataByName(L"System.Image.ColorSpace", &value)) && value.vt == VT_UI2)
+	{
+		sRGB = (value.uiVal == 1);
+	}
+
+	PropVariantClear(&value);
+	return sRGB;
+}
+
+AssetLoader::AssetLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ThreadPool* threadPool)
+{
+	this->device = device;
+	this->context = context;
+	this->threadPool = threadPool;
+	outstandingJobs = 0;
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Workers hold a pointer back to us
+	Finish();
+}
+
+void AssetLoader::LoadVertexShader(std::string name, std::wstring path)
+{
+	QueueJob(AssetType::VertexShader, name, [path](LoadedAsset& asset) {
+		return ISimpleShader::ReadShaderFile(path.c_str(), asset.ShaderBlob.GetAddressOf(), asset.Reflection);
+	});
+}
+
+void AssetLoader::LoadPixelShader(std::string name, std::wstring path)
+{
+	QueueJob(AssetType::PixelShader, name, [path](LoadedAsset& asset) {
+		return ISimpleShader::ReadShaderFile(path.c_str(), asset.ShaderBlob.GetAddressOf(), asset.Reflection);
+	});
+}
+
+void AssetLoader::LoadComputeShader(std::string name, std::wstring path)
+{
+	QueueJob(AssetType::ComputeShader, name, [path](LoadedAsset& asset) {
+		return ISimpleShader::ReadShaderFile(path.c_str(), asset.ShaderBlob.GetAddressOf(), asset.Reflection);
+	});
+}
+
+void AssetLoader::LoadMesh(std::string name, std::string path)
+{
+	QueueJob(AssetType::Mesh, name, [path](LoadedAsset& asset) {
+		return Mesh::LoadOBJ(path.c_str(), asset.Vertices, asset.Indices);
+	});
+}
+
+void AssetLoader::LoadTexture(std::string name, std::wstring path)
+{
+	QueueJob(AssetType::Texture, name, [path](LoadedAsset& asset) {
+		return DecodeImage(path, asset);
+	});
+}
+
+void AssetLoader::LoadMaterial(std::string name, const MaterialDesc& desc)
+{
+	PendingMaterial pending = { name, desc };
+	pendingMaterials.push_back(pending);
+
+	// Its dependencies may already be loaded
+	ResolveMaterials();
+}
+
+// --------------------------------------------------------
+// Hands the CPU side of a load to the thread pool, which
+// passes the result back through the completed queue
+// --------------------------------------------------------
+void AssetLoader::QueueJob(AssetType type, std::string name, std::function<bool(LoadedAsset&)> work)
+{
+	outstandingJobs++;
+	threadPool->Enqueue([this, type, name, work]() {
+		std::unique_ptr<LoadedAsset> asset = std::make_unique<LoadedAsset>();
+		asset->Type = type;
+		asset->Name = name;
+		asset->Succeeded = work(*asset);
+
+		{
+			std::lock_guard<std::mutex> lock(completedMutex);
+			completed.push_back(std::move(asset));
+		}
+		completedSignal.notify_one();
+	});
+}
+
+void AssetLoader::Update()
+{
+	std::deque<std::unique_ptr<LoadedAsset>> ready;
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		ready.swap(completed);
+	}
+
+	for (std::unique_ptr<LoadedAsset>& asset : ready)
+	{
+		CreateResources(*asset);
+		outstandingJobs--;
+	}
+
+	if (!ready.empty())
+		ResolveMaterials();
+}
+
+void AssetLoader::Finish()
+{
+	while (outstandingJobs > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(completedMutex);
+			completedSignal.wait(lock, [this] { return !completed.empty(); });
+		}
+		Update();
+	}
+
+	// Anything still waiting references an asset that was
+	// never queued, so create it with what we have
+	ResolveMaterials();
+	for (PendingMaterial& pending : pendingMaterials)
+	{
+		materials[pending.Name] = CreateMaterial(pending.Desc);
+	}
+	pendingMaterials.clear();
+}
+
+// --------------------------------------------------------
+// Main thread half of a load: turns the worker's CPU data
+// into device resources
+// --------------------------------------------------------
+void AssetLoader::CreateResources(LoadedAsset& asset)
+{
+	switch (asset.Type)
+	{
+	case AssetType::VertexShader:
+		vertexShaders[asset.Name] = asset.Succeeded ?
+			std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), asset.ShaderBlob.Get(), asset.Reflection) :
+			nullptr;
+		break;
+
+	case AssetType::PixelShader:
+		pixelShaders[asset.Name] = asset.Succeeded ?
+			std::make_shared<SimplePixelShader>(device.Get(), context.Get(), asset.ShaderBlob.Get(), asset.Reflection) :
+			nullptr;
+		break;
+
+	case AssetType::ComputeShader:
+		computeShaders[asset.Name] = asset.Succeeded ?
+			std::make_shared<SimpleComputeShader>(device.Get(), context.Get(), asset.ShaderBlob.Get(), asset.Reflection) :
+			nullptr;
+		break;
+
+	case AssetType::Mesh:
+		meshes[asset.Name] = asset.Succeeded ?
+			std::make_shared<Mesh>(asset.Vertices.data(), (int)asset.Vertices.size(), asset.Indices.data(), (int)asset.Indices.size(), device) :
+			nullptr;
+		break;
+
+	case AssetType::Texture:
+		textures[asset.Name] = asset.Succeeded ? CreateTexture(asset) : nullptr;
+		break;
+	}
+}
+
+// --------------------------------------------------------
+// Creates any pending materials whose textures and
+// shaders have all finished loading
+// --------------------------------------------------------
+void AssetLoader::ResolveMaterials()
+{
+	for (size_t i = 0; i < pendingMaterials.size();)
+	{
+		const MaterialDesc& desc = pendingMaterials[i].Desc;
+		bool ready =
+			textures.count(desc.Texture) &&
+			(desc.NormalMap.empty() || textures.count(desc.NormalMap)) &&
+			(desc.VertexPermutations || vertexShaders.count(desc.VertexShader)) &&
+			(desc.PixelPermutations || pixelShaders.count(desc.PixelShader));
+
+		if (!ready)
+		{
+			i++;
+			continue;
+		}
+
+		materials[pendingMaterials[i].Name] = CreateMaterial(desc);
+		pendingMaterials.erase(pendingMaterials.begin() + i);
+	}
+}
+
+// --------------------------------------------------------
+// Creates a material from whatever of its assets exist
+// (missing ones are null)
+// --------------------------------------------------------
+std::shared_ptr<Material> AssetLoader::CreateMaterial(const MaterialDesc& desc)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalMap = desc.NormalMap.empty() ? nullptr : GetTexture(desc.NormalMap);
+
+	// Permutations pick (and if need be compile) the variant
+	// for this material's features here, on the main thread
+	if (desc.VertexPermutations && desc.PixelPermutations)
+	{
+		return std::make_shared<Material>(desc.ColorTint, desc.Reflectivity, GetTexture(desc.Texture), desc.Sampler,
+			desc.VertexPermutations, desc.PixelPermutations, desc.ShaderFeatures, normalMap);
+	}
+
+	return std::make_shared<Material>(desc.ColorTint, desc.Reflectivity, GetTexture(desc.Texture), desc.Sampler,
+		GetVertexShader(desc.VertexShader), GetPixelShader(desc.PixelShader), normalMap);
+}
+
+// --------------------------------------------------------
+// Creates a texture (with a full mip chain when the format
+// supports generating one) from decoded pixels
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::CreateTexture(const LoadedAsset& asset)
+{
+	DXGI_FORMAT format = asset.IsSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	unsigned int rowPitch = asset.Width * 4;
+
+	UINT support = 0;
+	bool autoGenMips =
+		SUCCEEDED(device->CheckFormatSupport(format, &support)) &&
+		(support & D3D11_FORMAT_SUPPORT_MIP_AUTOGEN);
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = asset.Width;
+	desc.Height = asset.Height;
+	desc.MipLevels = autoGenMips ? 0 : 1;
+	desc.ArraySize = 1;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (autoGenMips ? D3D11_BIND_RENDER_TARGET : 0);
+	desc.MiscFlags = autoGenMips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = asset.Pixels.data();
+	initialData.SysMemPitch = rowPitch;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(device->CreateTexture2D(&desc, autoGenMips ? 0 : &initialData, texture.GetAddressOf())))
+		return nullptr;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = autoGenMips ? -1 : 1;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.GetAddressOf())))
+		return nullptr;
+
+	// Fill the top mip and let the GPU build the rest
+	if (autoGenMips)
+	{
+		context->UpdateSubresource(texture.Get(), 0, 0, asset.Pixels.data(), rowPitch, (UINT)asset.Pixels.size());
+		context->GenerateMips(srv.Get());
+	}
+
+	return srv;
+}
+
+// --------------------------------------------------------
+// Decodes an image file to 32bpp RGBA using WIC.
+// Runs on a worker thread.
+// --------------------------------------------------------
+bool AssetLoader::DecodeImage(const std::wstring& path, LoadedAsset& asset)
+{
+	// WIC needs COM on this thread
+	HRESULT coResult = CoInitializeEx(0, COINIT_MULTITHREADED);
+
+	bool result = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+			SUCCEEDED(factory->CreateDecoderFromFilename(path.c_str(), 0, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) &&
+			SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf())) &&
+			SUCCEEDED(frame->GetSize(&asset.Width, &asset.Height)) &&
+			SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf())) &&
+			SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom)))
+		{
+			unsigned int rowPitch = asset.Width * 4;
+			asset.Pixels.resize((size_t)rowPitch * asset.Height);
+			result = SUCCEEDED(converter->CopyPixels(0, rowPitch, (UINT)asset.Pixels.size(), asset.Pixels.data()));
+			asset.IsSRGB = HasSRGBMetadata(frame.Get());
+		}
+	}
+
+	// COM objects above are released by now
+	if (SUCCEEDED(coResult))
+		CoUninitialize();
+
+	return result && asset.Width > 0 && asset.Height > 0;
+}
+
+std::shared_ptr<SimpleVertexShader> AssetLoader::GetVertexShader(std::string name)
+{
+	auto it = vertexShaders.find(name);
+	return it != vertexShaders.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<SimplePixelShader> AssetLoader::GetPixelShader(std::string name)
+{
+	auto it = pixelShaders.find(name);
+	return it != pixelShaders.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<SimpleComputeShader> AssetLoader::GetComputeShader(std::string name)
+{
+	auto it = computeShaders.find(name);
+	return it != computeShaders.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<Mesh> AssetLoader::GetMesh(std::string name)
+{
+	auto it = meshes.find(name);
+	return it != meshes.end() ? it->second : nullptr;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::GetTexture(std::string name)
+{
+	auto it = textures.find(name);
+	return it != textures.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<Material> AssetLoader::GetMaterial(std::string name)
+{
+	auto it = materials.find(name);
+	return it != materials.end() ? it->second : nullptr;
+}
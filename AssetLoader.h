@@ -0,0 +1,144 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Material.h"
+#include "Mesh.h"
+#include "ShaderPermutations.h"
+#include "SimpleShader.h"
+#include "ThreadPool.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Describes a material by the names of the assets it uses,
+// so it can be created as soon as those have loaded.
+//
+// If both permutation sets are given, the shaders come from
+// those (by ShaderFeatures) and the shader names are ignored
+// --------------------------------------------------------
+struct MaterialDesc
+{
+	DirectX::XMFLOAT4 ColorTint;
+	float Reflectivity;
+	std::string Texture;
+	std::string NormalMap;		// Empty for no normal map
+	std::string VertexShader;
+	std::string PixelShader;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+	std::shared_ptr<ShaderPermutations> VertexPermutations;
+	std::shared_ptr<ShaderPermutations> PixelPermutations;
+	unsigned int ShaderFeatures = 0;
+};
+
+// --------------------------------------------------------
+// Loads shaders, meshes and textures in parallel.
+//
+// File reads and CPU work (shader reflection, OBJ parsing,
+// image decoding) run on the thread pool.  Only creating the
+// device resources happens on the main thread, in Update()
+// or Finish(), as each asset's CPU work completes.
+//
+// Assets are looked up by name once loaded.  An asset that
+// fails to load is still "loaded", just as a null pointer,
+// so anything depending on it doesn't wait forever.
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	AssetLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ThreadPool* threadPool);
+	~AssetLoader();
+
+	// Queue assets for loading - these return immediately
+	void LoadVertexShader(std::string name, std::wstring path);
+	void LoadPixelShader(std::string name, std::wstring path);
+	void LoadComputeShader(std::string name, std::wstring path);
+	void LoadMesh(std::string name, std::string path);
+	void LoadTexture(std::string name, std::wstring path);
+
+	// Materials wait on their textures and shaders
+	void LoadMaterial(std::string name, const MaterialDesc& desc);
+
+	// Main thread only: creates device resources for any
+	// finished work without blocking (Finish() blocks until
+	// everything queued so far is done)
+	void Update();
+	void Finish();
+
+	std::shared_ptr<SimpleVertexShader> GetVertexShader(std::string name);
+	std::shared_ptr<SimplePixelShader> GetPixelShader(std::string name);
+	std::shared_ptr<SimpleComputeShader> GetComputeShader(std::string name);
+	std::shared_ptr<Mesh> GetMesh(std::string name);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTexture(std::string name);
+	std::shared_ptr<Material> GetMaterial(std::string name);
+
+private:
+	enum class AssetType { VertexShader, PixelShader, ComputeShader, Mesh, Texture };
+
+	// The result of a worker's CPU work, handed back to the main thread
+	struct LoadedAsset
+	{
+		AssetType Type;
+		std::string Name;
+		bool Succeeded = false;
+
+		// Shaders
+		Microsoft::WRL::ComPtr<ID3DBlob> ShaderBlob;
+		ShaderReflectionData Reflection;
+
+		// Meshes
+		std::vector<Vertex> Vertices;
+		std::vector<unsigned int> Indices;
+
+		// Textures (tightly packed 32bpp RGBA)
+		std::vector<unsigned char> Pixels;
+		unsigned int Width = 0;
+		unsigned int Height = 0;
+		bool IsSRGB = false;
+	};
+
+	struct PendingMaterial
+	{
+		std::string Name;
+		MaterialDesc Desc;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	ThreadPool* threadPool;
+
+	// Work handed back from the workers
+	std::mutex completedMutex;
+	std::condition_variable completedSignal;
+	std::deque<std::unique_ptr<LoadedAsset>> completed;
+	unsigned int outstandingJobs;
+
+	std::vector<PendingMaterial> pendingMaterials;
+
+	// Finished assets
+	std::unordered_map<std::string, std::shared_ptr<SimpleVertexShader>> vertexShaders;
+	std::unordered_map<std::string, std::shared_ptr<SimplePixelShader>> pixelShaders;
+	std::unordered_map<std::string, std::shared_ptr<SimpleComputeShader>> computeShaders;
+	std::unordered_map<std::string, std::shared_ptr<Mesh>> meshes;
+	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textures;
+	std::unordered_map<std::string, std::shared_ptr<Material>> materials;
+
+	void QueueJob(AssetType type, std::string name, std::function<bool(LoadedAsset&)> work);
+	void CreateResources(LoadedAsset& asset);
+	void ResolveMaterials();
+	std::shared_ptr<Material> CreateMaterial(const MaterialDesc& desc);
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateTexture(const LoadedAsset& asset);
+
+	// Worker side CPU work
+	static bool DecodeImage(const std::wstring& path, LoadedAsset& asset);
+};
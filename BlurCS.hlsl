@@ -0,0 +1,56 @@
+// Must match BlurKernel::MaxRadius
+#define MAX_RADIUS 14
+#define GROUP_SIZE 128
+
+cbuffer externalData : register(b0)
+{
+	int horizontal;
+	int radius;
+	float4 weights[MAX_RADIUS + 1];	// x = weight; [0] is the center
+}
+
+// Textures and such
+Texture2D pixels				: register(t0);
+RWTexture2D<float4> output		: register(u0);
+
+// One line of texels plus the apron the kernel reaches
+// past either end, read from the texture just once
+groupshared float4 cache[GROUP_SIZE + 2 * MAX_RADIUS];
+
+// A position along one row (horizontal) or column
+int2 LinePixel(int line, int position)
+{
+	return horizontal ? int2(position, line) : int2(line, position);
+}
+
+// One direction of a separable Gaussian blur.  Each group
+// handles GROUP_SIZE texels of one row or column (SV_GroupID.y
+// picks which), so neighbouring outputs share their reads
+// through groupshared memory instead of refetching them
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint3 threadID : SV_GroupThreadID)
+{
+	uint width, height;
+	pixels.GetDimensions(width, height);
+	int lineLength = horizontal ? width : height;
+	int lineStart = groupID.x * GROUP_SIZE;
+
+	// Fill the cache, clamping at the edges like a clamp sampler
+	for (int i = threadID.x; i < GROUP_SIZE + 2 * MAX_RADIUS; i += GROUP_SIZE)
+	{
+		int position = clamp(lineStart - MAX_RADIUS + i, 0, lineLength - 1);
+		cache[i] = pixels.Load(int3(LinePixel(groupID.y, position), 0));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	int position = lineStart + threadID.x;
+	if (position >= lineLength)
+		return;
+
+	int center = threadID.x + MAX_RADIUS;
+	float4 totalColor = cache[center] * weights[0].x;
+	for (int r = 1; r <= radius; r++)
+		totalColor += (cache[center - r] + cache[center + r]) * weights[r].x;
+
+	output[LinePixel(groupID.y, position)] = totalColor;
+}
@@ -0,0 +1,84 @@
+#include "BlurKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+BlurKernel::BlurKernel(int radius)
+{
+	this->radius = (std::max)(0, (std::min)(radius, (int)MaxRadius));
+
+	// Discrete Gaussian, normalized over both sides
+	float sigma = (std::max)(this->radius / 3.0f, 0.5f);
+	float total = 0;
+	for (int i = 0; i <= this->radius; i++)
+	{
+		float weight = expf(-(float)(i * i) / (2 * sigma * sigma));
+		weights.push_back(weight);
+		total += i == 0 ? weight : 2 * weight;
+	}
+	for (float& weight : weights)
+		weight /= total;
+
+	// Merge texels (1,2), (3,4), ... into single samples.  An odd
+	// radius leaves the last texel with a zero weight partner
+	taps.push_back({ 0, weights[0] });
+	for (int i = 1; i <= this->radius; i += 2)
+	{
+		float first = weights[i];
+		float second = i + 1 <= this->radius ? weights[i + 1] : 0;
+		float weight = first + second;
+		taps.push_back({ (i * first + (i + 1) * second) / weight, weight });
+	}
+}
+
+int BlurKernel::GetDownsampleLevels(int radius, int maxLevels)
+{
+	int levels = 0;
+	while (levels < maxLevels && radius > MaxRadius)
+	{
+		radius = (radius + 1) / 2;
+		levels++;
+	}
+	return levels;
+}
+
+void BlurKernel::ApplyDiscrete(const float* source, float* destination, int count) const
+{
+	for (int x = 0; x < count; x++)
+	{
+		float sum = weights[0] * source[x];
+		for (int i = 1; i <= radius; i++)
+		{
+			sum += weights[i] * source[(std::max)(x - i, 0)];
+			sum += weights[i] * source[(std::min)(x + i, count - 1)];
+		}
+		destination[x] = sum;
+	}
+}
+
+// --------------------------------------------------------
+// Linearly filtered read at a fractional texel position,
+// clamping at the ends (what a clamp/linear sampler does)
+// --------------------------------------------------------
+static float SampleLinear(const float* source, int count, float position)
+{
+	float base = floorf(position);
+	float fraction = position - base;
+	int left = (std::max)(0, (std::min)((int)base, count - 1));
+	int right = (std::max)(0, (std::min)((int)base + 1, count - 1));
+	return source[left] + (source[right] - source[left]) * fraction;
+}
+
+void BlurKernel::ApplyBilinear(const float* source, float* destination, int count) const
+{
+	for (int x = 0; x < count; x++)
+	{
+		float sum = taps[0].Weight * source[x];
+		for (size_t i = 1; i < taps.size(); i++)
+		{
+			sum += taps[i].Weight * SampleLinear(source, count, x - taps[i].Offset);
+			sum += taps[i].Weight * SampleLinear(source, count, x + taps[i].Offset);
+		}
+		destination[x] = sum;
+	}
+}
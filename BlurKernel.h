@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// One texture sample of a blur pass: how far from the
+// center (in texels) and how much it counts
+// --------------------------------------------------------
+struct BlurTap
+{
+	float Offset;
+	float Weight;
+};
+
+// --------------------------------------------------------
+// Weights for a separable Gaussian blur, as used by
+// BlurPS.hlsl (the taps) and BlurCS.hlsl (the weights, as
+// it reads texels from groupshared memory, not a sampler).
+//
+// The discrete kernel has a weight for every texel within
+// the radius.  The shader doesn't take one sample per texel:
+// neighbouring pairs of texels are merged into a single
+// bilinear sample placed between them (weighted toward the
+// heavier one), which gives the same result with about half
+// the samples.  Taps[0] is the center; every other tap is
+// sampled on both sides.
+//
+// ApplyDiscrete() and ApplyBilinear() run one 1D pass on the
+// CPU, the slow way and the way the shader does it, so the
+// two can be compared.
+// --------------------------------------------------------
+class BlurKernel
+{
+public:
+	// Most taps per side the shader supports (incl. the center)
+	static const int MaxTaps = 8;
+	static const int MaxRadius = 2 * (MaxTaps - 1);
+
+	// Radius in texels, clamped to [0, MaxRadius].  Sigma is a
+	// third of the radius, so the kernel falls off to ~1%
+	BlurKernel(int radius);
+
+	int GetRadius() const { return radius; }
+
+	// Normalized weights, [0] being the center
+	const std::vector<float>& GetWeights() const { return weights; }
+	const std::vector<BlurTap>& GetTaps() const { return taps; }
+
+	// How many times to halve the resolution before blurring, so
+	// a blur of this radius (in full size texels) needs at most
+	// MaxRadius texels at the reduced size
+	static int GetDownsampleLevels(int radius, int maxLevels);
+
+	// One pass over a row of values, clamping at the ends
+	void ApplyDiscrete(const float* source, float* destination, int count) const;
+	void ApplyBilinear(const float* source, float* destination, int count) const;
+
+private:
+	int radius;
+	std::vector<float> weights;
+	std::vector<BlurTap> taps;
+};
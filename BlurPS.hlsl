@@ -0,0 +1,37 @@
+// Must match BlurKernel::MaxTaps
+#define MAX_TAPS 8
+
+cbuffer externalData : register(b0)
+{
+	float2 texelStep;		// One texel along the blur direction, in UVs
+	int tapCount;
+	float4 taps[MAX_TAPS];	// x = offset (texels), y = weight; [0] is the center
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D pixels			: register(t0);
+SamplerState samplerOptions	: register(s0);
+
+// One direction of a separable Gaussian blur.  Every tap
+// but the center is a linearly filtered sample between two
+// texels, taken on both sides
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float4 totalColor = pixels.Sample(samplerOptions, input.uv) * taps[0].y;
+
+	for (int i = 1; i < tapCount; i++)
+	{
+		float2 offset = texelStep * taps[i].x;
+		totalColor += pixels.Sample(samplerOptions, input.uv + offset) * taps[i].y;
+		totalColor += pixels.Sample(samplerOptions, input.uv - offset) * taps[i].y;
+	}
+
+	return totalColor;
+}
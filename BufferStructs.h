@@ -0,0 +1,71 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "Lights.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// C++ mirrors of our shaders' constant buffers, for use with
+// ISimpleShader::SetStruct().  Member names, order and padding
+// must match the HLSL - SetStruct() refuses a mismatch.
+// --------------------------------------------------------
+
+// ExternalData in VertexShader.hlsl (non-instanced variants)
+struct VertexShaderExternalData
+{
+	DirectX::XMFLOAT4 colorTint;
+	DirectX::XMFLOAT4X4 worldMatrix;
+	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
+	DirectX::XMFLOAT4X4 worldViewProjectionMatrix;
+
+	static const SimpleShaderStructField* GetShaderFields(unsigned int* count)
+	{
+		static const SimpleShaderStructField fields[] =
+		{
+			SIMPLE_SHADER_FIELD(VertexShaderExternalData, colorTint),
+			SIMPLE_SHADER_FIELD(VertexShaderExternalData, worldMatrix),
+			SIMPLE_SHADER_FIELD(VertexShaderExternalData, worldInverseTransposeMatrix),
+			SIMPLE_SHADER_FIELD(VertexShaderExternalData, worldViewProjectionMatrix),
+		};
+		*count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
+
+// ExternalData in PixelShader.hlsl (every variant)
+struct PixelShaderExternalData
+{
+	DirectionalLight light;
+	DirectionalLight light2;
+	DirectionalLight light3;
+	float reflectivity;
+	DirectX::XMFLOAT3 cameraPosition;
+	DirectX::XMFLOAT3 fogColor;
+	float fogStart;
+	float fogEnd;
+	DirectX::XMFLOAT2 clusterTileScale;
+	float clusterSliceScale;
+	float clusterSliceBias;
+	DirectX::XMUINT3 clusterCounts;
+
+	static const SimpleShaderStructField* GetShaderFields(unsigned int* count)
+	{
+		static const SimpleShaderStructField fields[] =
+		{
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, light),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, light2),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, light3),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, reflectivity),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, cameraPosition),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, fogColor),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, fogStart),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, fogEnd),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, clusterTileScale),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, clusterSliceScale),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, clusterSliceBias),
+			SIMPLE_SHADER_FIELD(PixelShaderExternalData, clusterCounts),
+		};
+		*count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
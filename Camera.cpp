@@ -7,6 +7,7 @@ Camera::Camera(float aspectRatio)
 	CreateTransform(XMFLOAT3(0, 0, -10), XMFLOAT3(0, 0, 0));
 	UpdateProjectionMatrix(aspectRatio);
 	UpdateViewMatrix();
+	StoreViewProjection();
 }
 
 Camera::Camera(DirectX::XMFLOAT3 pos, DirectX::XMFLOAT3 orientation, float aspectRatio,
@@ -17,6 +18,7 @@ Camera::Camera(DirectX::XMFLOAT3 pos, DirectX::XMFLOAT3 orientation, float aspec
 	CreateTransform(pos, orientation);
 	UpdateProjectionMatrix(aspectRatio);
 	UpdateViewMatrix();
+	StoreViewProjection();
 }
 
 DirectX::XMFLOAT4X4 Camera::GetViewMatrix() const
@@ -29,6 +31,11 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix() const
 	return projectionMatrix;
 }
 
+DirectX::XMFLOAT4X4 Camera::GetPreviousViewProjectionMatrix() const
+{
+	return previousViewProjectionMatrix;
+}
+
 Transform* Camera::GetTransform() const
 {
 	return transform.get();
@@ -51,6 +58,8 @@ void Camera::UpdateViewMatrix()
 
 void Camera::Update(float dt, HWND windowHandle)
 {
+	// Last frame's matrices, before anything moves
+	StoreViewProjection();
 	didCameraChange = false;
 
 	//choose the move speed
@@ -117,7 +126,7 @@ void Camera::Update(float dt, HWND windowHandle)
 
 bool Camera::GetDidCameraChange()
 {
-	return true;
+	return didCameraChange;
 }
 
 void Camera::SetAllCustomOptions(float fieldView, float nearClp, float farClp, float moveSpd, float fastMoveSpd, float mouseLookSpd)
@@ -136,3 +145,9 @@ void Camera::CreateTransform(DirectX::XMFLOAT3 pos, DirectX::XMFLOAT3 orientatio
 	transform->SetPosition(pos.x, pos.y, pos.z);
 	transform->SetRotation(orientation.x, orientation.y, orientation.z);
 }
+
+void Camera::StoreViewProjection()
+{
+	XMMATRIX viewProjection = XMMatrixMultiply(XMLoadFloat4x4(&viewMatrix), XMLoadFloat4x4(&projectionMatrix));
+	XMStoreFloat4x4(&previousViewProjectionMatrix, viewProjection);
+}
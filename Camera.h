@@ -15,7 +15,11 @@ public:
 
 	DirectX::XMFLOAT4X4 GetViewMatrix() const;
 	DirectX::XMFLOAT4X4 GetProjectionMatrix() const;
+	// View * projection as of the start of the last Update()
+	DirectX::XMFLOAT4X4 GetPreviousViewProjectionMatrix() const;
 	Transform* GetTransform() const;
+	float GetNearClip() const { return nearClip; }
+	float GetFarClip() const { return farClip; }
 
 	//TODO make setters
 	void UpdateProjectionMatrix(float aspectRatio);
@@ -28,6 +32,7 @@ private:
 
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projectionMatrix;
+	DirectX::XMFLOAT4X4 previousViewProjectionMatrix; // For reprojecting last frame (motion blur)
 
 	POINT prevMousePosition;
 
@@ -44,5 +49,6 @@ private:
 	void SetAllCustomOptions(float fieldView, float nearClp, float farClp,
 		float moveSpd, float fastMoveSpd, float mouseLookSpd);
 	void CreateTransform(DirectX::XMFLOAT3 pos, DirectX::XMFLOAT3 orientation);
+	void StoreViewProjection();
 };
 
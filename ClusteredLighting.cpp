@@ -0,0 +1,96 @@
+#include "ClusteredLighting.h"
+
+#include <cstring>
+
+using namespace DirectX;
+
+ClusteredLighting::ClusteredLighting(Microsoft::WRL::ComPtr<ID3D11Device> device, ThreadPool* threadPool)
+	: clusters(threadPool)
+{
+	this->device = device;
+	tileScale = XMFLOAT2(0, 0);
+}
+
+void ClusteredLighting::Update(ID3D11DeviceContext* context, const std::vector<PointLight>& lights,
+	Camera* camera, unsigned int screenWidth, unsigned int screenHeight)
+{
+	clusters.Build(lights.data(), lights.size(),
+		camera->GetViewMatrix(), camera->GetProjectionMatrix(),
+		camera->GetNearClip(), camera->GetFarClip());
+
+	tileScale = XMFLOAT2(
+		(float)LightClusters::ClustersX / screenWidth,
+		(float)LightClusters::ClustersY / screenHeight);
+
+	const std::vector<LightClusterRange>& ranges = clusters.GetClusters();
+	const std::vector<uint32_t>& indices = clusters.GetLightIndices();
+	Upload(context, lightBuffer, lights.data(), lights.size(), sizeof(PointLight));
+	Upload(context, clusterBuffer, ranges.data(), ranges.size(), sizeof(LightClusterRange));
+	Upload(context, indexBuffer, indices.data(), indices.size(), sizeof(uint32_t));
+}
+
+void ClusteredLighting::SetShaderResources(SimplePixelShader* ps)
+{
+	ps->SetShaderResourceView("pointLights", lightBuffer.View.Get());
+	ps->SetShaderResourceView("lightClusters", clusterBuffer.View.Get());
+	ps->SetShaderResourceView("lightIndices", indexBuffer.View.Get());
+}
+
+XMUINT3 ClusteredLighting::GetClusterCounts()
+{
+	return XMUINT3(LightClusters::ClustersX, LightClusters::ClustersY, LightClusters::ClustersZ);
+}
+
+// --------------------------------------------------------
+// Copies data into a dynamic structured buffer, recreating
+// it (and its SRV) at double the size if it's too small.
+// Buffers always hold at least one element, so there's
+// something to bind with no lights
+// --------------------------------------------------------
+bool ClusteredLighting::Upload(ID3D11DeviceContext* context, DynamicBuffer& buffer, const void* data, size_t count, size_t stride)
+{
+	if (count > buffer.Capacity || !buffer.Buffer)
+	{
+		size_t capacity = buffer.Capacity > 0 ? buffer.Capacity : 64;
+		while (capacity < count)
+			capacity *= 2;
+
+		buffer.Buffer.Reset();
+		buffer.View.Reset();
+		buffer.Capacity = 0;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = (UINT)(capacity * stride);
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = (UINT)stride;
+		if (FAILED(device->CreateBuffer(&desc, 0, buffer.Buffer.GetAddressOf())))
+			return false;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = (UINT)capacity;
+		if (FAILED(device->CreateShaderResourceView(buffer.Buffer.Get(), &srvDesc, buffer.View.GetAddressOf())))
+		{
+			buffer.Buffer.Reset();
+			return false;
+		}
+
+		buffer.Capacity = capacity;
+	}
+
+	if (count == 0)
+		return true;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+
+	memcpy(mapped.pData, data, count * stride);
+	context->Unmap(buffer.Buffer.Get(), 0);
+	return true;
+}
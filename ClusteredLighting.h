@@ -0,0 +1,57 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include <vector>
+
+#include "Camera.h"
+#include "LightClusters.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Uploads a frame's point lights and their LightClusters
+// lists for PixelShader.hlsl (the POINT_LIGHTS variants):
+//   pointLights   - StructuredBuffer<PointLight>
+//   lightClusters - StructuredBuffer<uint2> (offset, count)
+//   lightIndices  - StructuredBuffer<uint>
+// Buffers are dynamic and grow (doubling) as needed.
+// --------------------------------------------------------
+class ClusteredLighting
+{
+public:
+	ClusteredLighting(Microsoft::WRL::ComPtr<ID3D11Device> device, ThreadPool* threadPool);
+
+	// Bins the lights for this camera and uploads everything.
+	// The screen size maps pixels to cluster tiles
+	void Update(ID3D11DeviceContext* context, const std::vector<PointLight>& lights,
+		Camera* camera, unsigned int screenWidth, unsigned int screenHeight);
+
+	// Stages the buffers on a pixel shader (variants
+	// without point lights simply don't have them)
+	void SetShaderResources(SimplePixelShader* ps);
+
+	// Values for the shader's cluster lookup
+	DirectX::XMFLOAT2 GetTileScale() { return tileScale; }
+	float GetSliceScale() { return clusters.GetSliceScale(); }
+	float GetSliceBias() { return clusters.GetSliceBias(); }
+	DirectX::XMUINT3 GetClusterCounts();
+
+private:
+	struct DynamicBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+		size_t Capacity = 0;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	LightClusters clusters;
+	DirectX::XMFLOAT2 tileScale;
+
+	DynamicBuffer lightBuffer;
+	DynamicBuffer clusterBuffer;
+	DynamicBuffer indexBuffer;
+
+	bool Upload(ID3D11DeviceContext* context, DynamicBuffer& buffer, const void* data, size_t count, size_t stride);
+};
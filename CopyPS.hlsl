@@ -0,0 +1,23 @@
+cbuffer externalData : register(b0)
+{
+	float2 uvScale;		// Part of the texture to copy (for a scene rendered at a lower resolution)
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D pixels			: register(t0);
+SamplerState samplerOptions	: register(s0);
+
+// Copies a texture to a target of any size.  With a linear
+// sampler, halving the size averages each 2x2 block (one
+// sample lands exactly between the four texels)
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	return pixels.Sample(samplerOptions, input.uv * uvScale);
+}
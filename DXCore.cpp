@@ -1,6 +1,9 @@
 #include "DXCore.h"
 
 #include <WindowsX.h>
+#include <timeapi.h>
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
 // Define the static instance variable so our OS-level 
@@ -49,6 +52,7 @@ DXCore::DXCore(
 
 	// Initialize fields
 	this->hasFocus = true; 
+	this->isMinimized = false;
 	
 	this->fpsFrameCount = 0;
 	this->fpsTimeElapsed = 0.0f;
@@ -57,10 +61,35 @@ DXCore::DXCore(
 	this->startTime = 0;
 	this->totalTime = 0;
 
+	// No frame limit or waitable swap chain yet
+	this->framePacer = std::make_unique<FramePacer>();
+	this->maxFrameLatency = 3;
+	this->lowLatencyMode = false;
+	this->frameLatencyWaitable = 0;
+	this->swapChainFlags = 0;
+	this->waitTime = 0;
+	this->lastFrameWaitTime = 0;
+
+	// Tick slowly while in the background
+	this->backgroundFrameRate = 10.0;
+	this->wasInBackground = false;
+	this->resuming = false;
+
+	// Variable time step until asked otherwise
+	this->fixedTimeStep = 0;
+	this->maxSimulationSteps = 5;
+	this->simulationTime = 0;
+	this->accumulator = 0;
+	this->interpolation = 1.0f;
+
 	// Query performance counter for accurate timing information
 	__int64 perfFreq;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
 	perfCounterSeconds = 1.0 / (double)perfFreq;
+
+	// Ask for 1ms scheduler resolution, so the frame
+	// limiter's Sleep() calls wake up close to on time
+	timeBeginPeriod(1);
 }
 
 // --------------------------------------------------------
@@ -72,6 +101,10 @@ DXCore::~DXCore()
 	// we don't need to explicitly clean up those DirectX objects
 	// - If we weren't using smart pointers, we'd need
 	//   to call Release() on each DirectX object
+	if (frameLatencyWaitable)
+		CloseHandle(frameLatencyWaitable);
+
+	timeEndPeriod(1);
 }
 
 // --------------------------------------------------------
@@ -182,7 +215,7 @@ HRESULT DXCore::InitDirectX()
 	swapDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
 	swapDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
 	swapDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swapDesc.Flags = 0;
+	swapDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 	swapDesc.OutputWindow = hWnd;
 	swapDesc.SampleDesc.Count = 1;
 	swapDesc.SampleDesc.Quality = 0;
@@ -192,21 +225,39 @@ HRESULT DXCore::InitDirectX()
 	// Result variable for below function calls
 	HRESULT hr = S_OK;
 
-	// Attempt to initialize DirectX
-	hr = D3D11CreateDeviceAndSwapChain(
-		0,							// Video adapter (physical GPU) to use, or null for default
-		D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
-		0,							// Used when doing software rendering
-		deviceFlags,				// Any special options
-		0,							// Optional array of possible verisons we want as fallbacks
-		0,							// The number of fallbacks in the above param
-		D3D11_SDK_VERSION,			// Current version of the SDK
-		&swapDesc,					// Address of swap chain options
-		swapChain.GetAddressOf(),	// Pointer to our Swap Chain pointer
-		device.GetAddressOf(),		// Pointer to our Device pointer
-		&dxFeatureLevel,			// This will hold the actual feature level the app will use
-		context.GetAddressOf());	// Pointer to our Device Context pointer
+	// Attempt to initialize DirectX.  Older versions of Windows
+	// don't know the waitable swap chain flag, so try again
+	// without it if that fails
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		hr = D3D11CreateDeviceAndSwapChain(
+			0,							// Video adapter (physical GPU) to use, or null for default
+			D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
+			0,							// Used when doing software rendering
+			deviceFlags,				// Any special options
+			0,							// Optional array of possible verisons we want as fallbacks
+			0,							// The number of fallbacks in the above param
+			D3D11_SDK_VERSION,			// Current version of the SDK
+			&swapDesc,					// Address of swap chain options
+			swapChain.GetAddressOf(),	// Pointer to our Swap Chain pointer
+			device.GetAddressOf(),		// Pointer to our Device pointer
+			&dxFeatureLevel,			// This will hold the actual feature level the app will use
+			context.GetAddressOf());	// Pointer to our Device Context pointer
+		if (SUCCEEDED(hr) || swapDesc.Flags == 0)
+			break;
+
+		swapDesc.Flags = 0;
+	}
 	if (FAILED(hr)) return hr;
+	swapChainFlags = swapDesc.Flags;
+
+	// Grab the swap chain's frame latency waitable object, which
+	// lets us wait for the GPU *before* starting a frame instead
+	// of blocking in Present() with the frame's input already read
+	Microsoft::WRL::ComPtr<IDXGISwapChain2> swapChain2;
+	if (swapChainFlags != 0 && SUCCEEDED(swapChain.As(&swapChain2)))
+		frameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+	ApplyFrameLatency();
 
 	// The above function created the back buffer render target
 	// for us, but we need a reference to it
@@ -234,15 +285,25 @@ HRESULT DXCore::InitDirectX()
 	depthStencilDesc.Height				= height;
 	depthStencilDesc.MipLevels			= 1;
 	depthStencilDesc.ArraySize			= 1;
-	depthStencilDesc.Format				= DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilDesc.Format				= DXGI_FORMAT_R24G8_TYPELESS; // Typeless, so it can also be read as a texture
 	depthStencilDesc.Usage				= D3D11_USAGE_DEFAULT;
-	depthStencilDesc.BindFlags			= D3D11_BIND_DEPTH_STENCIL;
+	depthStencilDesc.BindFlags			= D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	depthStencilDesc.CPUAccessFlags		= 0;
 	depthStencilDesc.MiscFlags			= 0;
 	depthStencilDesc.SampleDesc.Count	= 1;
 	depthStencilDesc.SampleDesc.Quality = 0;
 
-	// Create the depth buffer and its view, then 
+	// Views of the depth buffer as depth and (24 bit) texture
+	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc = {};
+	depthStencilViewDesc.Format			= DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilViewDesc.ViewDimension	= D3D11_DSV_DIMENSION_TEXTURE2D;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC depthSRVDesc = {};
+	depthSRVDesc.Format					= DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	depthSRVDesc.ViewDimension			= D3D11_SRV_DIMENSION_TEXTURE2D;
+	depthSRVDesc.Texture2D.MipLevels	= 1;
+
+	// Create the depth buffer and its views, then 
 	// release our reference to the texture
 	ID3D11Texture2D* depthBufferTexture = 0;
 	device->CreateTexture2D(&depthStencilDesc, 0, &depthBufferTexture);
@@ -250,8 +311,12 @@ HRESULT DXCore::InitDirectX()
 	{
 		device->CreateDepthStencilView(
 			depthBufferTexture, 
-			0, 
+			&depthStencilViewDesc, 
 			depthStencilView.GetAddressOf());
+		device->CreateShaderResourceView(
+			depthBufferTexture,
+			&depthSRVDesc,
+			depthStencilSRV.GetAddressOf());
 		depthBufferTexture->Release();
 	}
 
@@ -290,6 +355,7 @@ void DXCore::OnResize()
 	// Release the buffers before resizing the swap chain
 	backBufferRTV.Reset();
 	depthStencilView.Reset();
+	depthStencilSRV.Reset();
 
 	// Resize the underlying swap chain buffers
 	swapChain->ResizeBuffers(
@@ -297,7 +363,7 @@ void DXCore::OnResize()
 		width,
 		height,
 		DXGI_FORMAT_R8G8B8A8_UNORM,
-		0);
+		swapChainFlags); // Must match the flags the swap chain was created with
 
 	// Recreate the render target view for the back buffer
 	// texture, then release our local texture reference
@@ -318,15 +384,25 @@ void DXCore::OnResize()
 	depthStencilDesc.Height				= height;
 	depthStencilDesc.MipLevels			= 1;
 	depthStencilDesc.ArraySize			= 1;
-	depthStencilDesc.Format				= DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilDesc.Format				= DXGI_FORMAT_R24G8_TYPELESS; // Typeless, so it can also be read as a texture
 	depthStencilDesc.Usage				= D3D11_USAGE_DEFAULT;
-	depthStencilDesc.BindFlags			= D3D11_BIND_DEPTH_STENCIL;
+	depthStencilDesc.BindFlags			= D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	depthStencilDesc.CPUAccessFlags		= 0;
 	depthStencilDesc.MiscFlags			= 0;
 	depthStencilDesc.SampleDesc.Count	= 1;
 	depthStencilDesc.SampleDesc.Quality = 0;
 
-	// Create the depth buffer and its view, then 
+	// Views of the depth buffer as depth and (24 bit) texture
+	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc = {};
+	depthStencilViewDesc.Format			= DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilViewDesc.ViewDimension	= D3D11_DSV_DIMENSION_TEXTURE2D;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC depthSRVDesc = {};
+	depthSRVDesc.Format					= DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	depthSRVDesc.ViewDimension			= D3D11_SRV_DIMENSION_TEXTURE2D;
+	depthSRVDesc.Texture2D.MipLevels	= 1;
+
+	// Create the depth buffer and its views, then 
 	// release our reference to the texture
 	ID3D11Texture2D* depthBufferTexture = 0;
 	device->CreateTexture2D(&depthStencilDesc, 0, &depthBufferTexture);
@@ -334,8 +410,12 @@ void DXCore::OnResize()
 	{
 		device->CreateDepthStencilView(
 			depthBufferTexture, 
-			0, 
+			&depthStencilViewDesc, 
 			depthStencilView.ReleaseAndGetAddressOf()); // ReleaseAndGetAddressOf() cleans up the old object before giving us the pointer
+		device->CreateShaderResourceView(
+			depthBufferTexture,
+			&depthSRVDesc,
+			depthStencilSRV.ReleaseAndGetAddressOf());
 		depthBufferTexture->Release();
 	}
 
@@ -391,14 +471,46 @@ HRESULT DXCore::Run()
 		}
 		else
 		{
+			// Sleep (still waking for messages) while in the background
+			if (!WaitInBackground())
+				continue;
+
+			// In low latency mode, do all of the frame's waiting
+			// first, then handle whatever input arrived meanwhile,
+			// so the frame is simulated from the newest input
+			if (lowLatencyMode)
+			{
+				WaitForFrame();
+
+				bool quit = false;
+				while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+				{
+					if (msg.message == WM_QUIT)
+					{
+						quit = true;
+						break;
+					}
+
+					TranslateMessage(&msg);
+					DispatchMessage(&msg);
+				}
+				if (quit)
+					break;
+			}
+
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
 			// The game loop
-			Update(deltaTime, totalTime);
+			UpdateFrame(deltaTime, totalTime);
+			Simulate();
 			Draw(deltaTime, totalTime);
+
+			// Otherwise wait after the frame, like a blocking Present()
+			if (!lowLatencyMode)
+				WaitForFrame();
 		}
 	}
 
@@ -408,6 +520,168 @@ HRESULT DXCore::Run()
 }
 
 
+// --------------------------------------------------------
+// Switches to fixed ticks of the given length (0 for one
+// variable tick per frame), running at most maxSteps a frame
+// --------------------------------------------------------
+void DXCore::SetFixedTimeStep(float seconds, int maxSteps)
+{
+	fixedTimeStep = (std::max)(seconds, 0.0f);
+	maxSimulationSteps = (std::max)(maxSteps, 1);
+	simulationTime = totalTime;
+	accumulator = 0;
+	interpolation = 1.0f;
+}
+
+
+// --------------------------------------------------------
+// Feeds the frame's time to the simulation.  With a fixed
+// time step, whole ticks are run and the remainder is kept
+// for next frame (and used to interpolate this one)
+// --------------------------------------------------------
+void DXCore::Simulate()
+{
+	if (fixedTimeStep <= 0)
+	{
+		Update(deltaTime, totalTime);
+		interpolation = 1.0f;
+		return;
+	}
+
+	accumulator += deltaTime;
+
+	int steps = 0;
+	while (accumulator >= fixedTimeStep && steps < maxSimulationSteps)
+	{
+		simulationTime += fixedTimeStep;
+		Update(fixedTimeStep, (float)simulationTime);
+		accumulator -= fixedTimeStep;
+		steps++;
+	}
+
+	// Still behind after the most ticks we'll run in a frame?
+	// Drop the backlog instead of trying to catch up later
+	if (accumulator >= fixedTimeStep)
+		accumulator = fmod(accumulator, (double)fixedTimeStep);
+
+	interpolation = (float)(accumulator / fixedTimeStep);
+}
+
+
+// --------------------------------------------------------
+// Limits the frame rate (0 for no limit)
+// --------------------------------------------------------
+void DXCore::SetTargetFrameRate(double framesPerSecond)
+{
+	framePacer->SetTargetFrameRate(framesPerSecond);
+}
+
+
+// --------------------------------------------------------
+// Sets how many frames the CPU may queue ahead of the GPU.
+// Fewer frames means less input latency, but less slack to
+// absorb uneven frame times
+// --------------------------------------------------------
+void DXCore::SetMaximumFrameLatency(unsigned int frames)
+{
+	maxFrameLatency = (std::max)((std::min)(frames, 16u), 1u);
+	ApplyFrameLatency();
+}
+
+
+// --------------------------------------------------------
+// Turns low latency mode on or off (see DXCore.h)
+// --------------------------------------------------------
+void DXCore::SetLowLatencyMode(bool enabled)
+{
+	lowLatencyMode = enabled;
+	ApplyFrameLatency();
+}
+
+
+// --------------------------------------------------------
+// Sends the frame latency to the swap chain if it's waitable,
+// otherwise to the device (which makes Present() block)
+// --------------------------------------------------------
+void DXCore::ApplyFrameLatency()
+{
+	if (!swapChain)
+		return;
+
+	UINT latency = lowLatencyMode ? 1 : maxFrameLatency;
+
+	Microsoft::WRL::ComPtr<IDXGISwapChain2> swapChain2;
+	if (frameLatencyWaitable && SUCCEEDED(swapChain.As(&swapChain2)))
+	{
+		swapChain2->SetMaximumFrameLatency(latency);
+		return;
+	}
+
+	Microsoft::WRL::ComPtr<IDXGIDevice1> dxgiDevice;
+	if (SUCCEEDED(device.As(&dxgiDevice)))
+		dxgiDevice->SetMaximumFrameLatency(latency);
+}
+
+
+// --------------------------------------------------------
+// Waits until the GPU has room for another frame (if the
+// swap chain is waitable), then for the frame limiter
+// --------------------------------------------------------
+void DXCore::WaitForFrame()
+{
+	if (frameLatencyWaitable)
+		WaitForSingleObjectEx(frameLatencyWaitable, 1000, TRUE);
+
+	framePacer->WaitForNextFrame();
+	waitTime += framePacer->GetLastWaitTime();
+}
+
+
+// --------------------------------------------------------
+// Handles background mode before a frame.  Minimized windows
+// (and unfocused ones with a background frame rate of 0) just
+// wait for messages; other unfocused windows wait until a
+// background frame is due.  Returns true if a frame should
+// run now, or false if a message arrived while waiting
+// --------------------------------------------------------
+bool DXCore::WaitInBackground()
+{
+	__int64 waitStart;
+	QueryPerformanceCounter((LARGE_INTEGER*)&waitStart);
+
+	// Paused: sleep until there's a message to handle
+	if (isMinimized || (!hasFocus && backgroundFrameRate <= 0))
+	{
+		WaitMessage();
+		resuming = true;
+		return false;
+	}
+
+	// Coming back to the foreground
+	if (hasFocus)
+	{
+		if (wasInBackground)
+			resuming = true;
+		wasInBackground = false;
+		return true;
+	}
+
+	// Unfocused: wait for the next background frame, or a message
+	wasInBackground = true;
+	double untilFrame = 1.0 / backgroundFrameRate - (waitStart - previousTime) * perfCounterSeconds;
+	if (untilFrame <= 0)
+		return true;
+
+	DWORD result = MsgWaitForMultipleObjects(0, 0, FALSE, (DWORD)(untilFrame * 1000.0 + 0.5), QS_ALLINPUT);
+
+	__int64 waitEnd;
+	QueryPerformanceCounter((LARGE_INTEGER*)&waitEnd);
+	waitTime += (waitEnd - waitStart) * perfCounterSeconds;
+
+	return result != WAIT_OBJECT_0;
+}
+
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
@@ -434,6 +708,17 @@ void DXCore::UpdateTimer()
 	//    or the process itself gets moved to another core
 	deltaTime = max((float)((currentTime - previousTime) * perfCounterSeconds), 0.0f);
 
+	// The first frame after a pause (or a spell of slow background
+	// frames) would otherwise see one huge step
+	lastFrameWaitTime = (float)waitTime;
+	waitTime = 0;
+	if (resuming)
+	{
+		deltaTime = min(deltaTime, MaxResumeDeltaTime);
+		lastFrameWaitTime = min(lastFrameWaitTime, deltaTime);
+		resuming = false;
+	}
+
 	// Calculate the total time from start to now
 	totalTime = (float)((currentTime - startTime) * perfCounterSeconds);
 
@@ -647,7 +932,9 @@ LRESULT DXCore::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 		// Don't adjust anything when minimizing,
 		// since we end up with a width/height of zero
 		// and that doesn't play well with the GPU
-		if (wParam == SIZE_MINIMIZED)
+		//  - Run() pauses while minimized
+		isMinimized = (wParam == SIZE_MINIMIZED);
+		if (isMinimized)
 			return 0;
 		
 		// Save the new client area dimensions.
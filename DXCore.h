@@ -2,12 +2,18 @@
 
 #include <Windows.h>
 #include <d3d11.h>
+#include <dxgi1_3.h>
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "winmm.lib")
+
+#include "FramePacer.h"
 
 class DXCore
 {
@@ -40,8 +46,16 @@ public:
 	virtual void OnResize();
 
 	// Pure virtual methods for setup and game functionality
+	//  - With a fixed time step, Update() runs zero or more times
+	//    per frame, always with deltaTime equal to the step and
+	//    totalTime the simulated time.  Otherwise it runs once
+	//    per frame, like UpdateFrame()
+	//  - UpdateFrame() runs once per frame (before any Update()
+	//    calls) with the frame's real times, for things like the
+	//    camera that should follow input at the display's rate
 	virtual void Init() = 0;
 	virtual void Update(float deltaTime, float totalTime) = 0;
+	virtual void UpdateFrame(float deltaTime, float totalTime) {}
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
 protected:
@@ -57,6 +71,7 @@ protected:
 	// Does our window currently have focus?
 	// Helpful if we want to pause while not the active window
 	bool hasFocus;
+	bool isMinimized;
 
 	// DirectX related objects and variables
 	D3D_FEATURE_LEVEL		dxFeatureLevel;
@@ -66,6 +81,7 @@ protected:
 
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencilView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> depthStencilSRV;	// Same depth buffer, for reading in shaders
 
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
@@ -77,6 +93,43 @@ protected:
 	std::string GetFullPathTo(std::string relativeFilePath);
 	std::wstring GetFullPathTo_Wide(std::wstring relativeFilePath);
 
+	// Frame pacing
+	//  - Target frame rate: 0 doesn't limit (the default)
+	//  - Maximum frame latency: how many frames the CPU may queue
+	//    up ahead of the GPU (1 to 16, DXGI's default is 3)
+	//  - Low latency mode: wait for the GPU and the frame limiter
+	//    *before* reading input, so input is as fresh as possible
+	//    when the frame reaches the screen.  Uses a latency of 1
+	void SetTargetFrameRate(double framesPerSecond);
+	void SetMaximumFrameLatency(unsigned int frames);
+	void SetLowLatencyMode(bool enabled);
+	bool GetLowLatencyMode() { return lowLatencyMode; }
+
+	// Background mode, while the window is unfocused or minimized
+	//  - Unfocused windows update and draw at this rate instead
+	//    (0 pauses them entirely; the default is 10)
+	//  - Minimized windows always pause, as there's nothing to see
+	//  - Messages are still handled either way, and the first
+	//    deltaTime after coming back is capped at MaxResumeDeltaTime
+	static constexpr float MaxResumeDeltaTime = 1.0f / 30.0f;
+	void SetBackgroundFrameRate(double framesPerSecond) { backgroundFrameRate = (std::max)(framesPerSecond, 0.0); }
+	double GetBackgroundFrameRate() { return backgroundFrameRate; }
+
+	// Fixed time step simulation
+	//  - 0 (the default) runs Update() once a frame instead
+	//  - At most maxSteps ticks run per frame; beyond that the
+	//    simulation slows down rather than falling further behind
+	//  - Draw() should blend each object's previous and current
+	//    tick by GetInterpolation() (0 is the previous tick, 1 the
+	//    current one, always 1 without a fixed time step)
+	void SetFixedTimeStep(float seconds, int maxSteps = 5);
+	float GetFixedTimeStep() { return fixedTimeStep; }
+	float GetInterpolation() { return interpolation; }
+
+	// Seconds the frame limiter and background mode slept
+	// before the current frame (already included in deltaTime)
+	float GetLastFrameWaitTime() { return lastFrameWaitTime; }
+
 
 private:
 	// Timing related data
@@ -91,7 +144,32 @@ private:
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 
+	// Frame pacing
+	std::unique_ptr<FramePacer> framePacer;
+	unsigned int maxFrameLatency;
+	bool lowLatencyMode;
+	HANDLE frameLatencyWaitable;	// Null if the swap chain doesn't have one
+	UINT swapChainFlags;			// Needed again when resizing
+	double waitTime;				// Slept since the last UpdateTimer()
+	float lastFrameWaitTime;
+
+	// Background mode
+	double backgroundFrameRate;
+	bool wasInBackground;	// Was the last frame drawn unfocused?
+	bool resuming;			// Clamp the next deltaTime?
+
+	// Fixed time step simulation
+	float fixedTimeStep;
+	int maxSimulationSteps;
+	double simulationTime;	// Time the simulation has reached
+	double accumulator;		// Real time not simulated yet
+	float interpolation;
+
 	void UpdateTimer();			// Updates the timer for this frame
+	void Simulate();			// Runs this frame's fixed ticks (or one variable one)
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+	void ApplyFrameLatency();	// Sends the current latency setting to DXGI
+	void WaitForFrame();		// Blocks until the GPU and frame limiter are ready for another frame
+	bool WaitInBackground();	// Throttles or pauses while unfocused; false if a message arrived first
 };
 
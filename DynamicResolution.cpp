@@ -0,0 +1,61 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(float targetFrameTime, float minScale, float maxScale)
+{
+	this->targetFrameTime = targetFrameTime;
+	this->minScale = minScale;
+	this->maxScale = maxScale;
+	Reset();
+}
+
+float DynamicResolution::Update(float frameTime)
+{
+	// Ignore nonsense (e.g. a zero time on the first frame)
+	if (!(frameTime > 0))
+		return scale;
+
+	averageFrameTime = hasAverage ?
+		averageFrameTime + (frameTime - averageFrameTime) * Smoothing :
+		frameTime;
+	hasAverage = true;
+
+	framesSinceChange++;
+	if (framesSinceChange < CooldownFrames)
+		return scale;
+
+	bool overBudget = averageFrameTime > targetFrameTime;
+	bool underBudget = averageFrameTime < targetFrameTime * RaiseThreshold;
+	if (!overBudget && !underBudget)
+		return scale;
+
+	float desired = scale * sqrtf(targetFrameTime / averageFrameTime);
+	desired = roundf(desired / ScaleStep) * ScaleStep;
+	desired = (std::max)(minScale, (std::min)(desired, maxScale));
+
+	// Rounding can land back on the current scale; make sure
+	// an over budget frame always steps down (and vice versa)
+	if (overBudget && desired >= scale)
+		desired = (std::max)(minScale, scale - ScaleStep);
+	if (underBudget && desired <= scale)
+		desired = (std::min)(maxScale, scale + ScaleStep);
+
+	if (desired != scale)
+	{
+		scale = desired;
+		hasAverage = false;
+		framesSinceChange = 0;
+	}
+
+	return scale;
+}
+
+void DynamicResolution::Reset()
+{
+	scale = maxScale;
+	averageFrameTime = 0;
+	hasAverage = false;
+	framesSinceChange = 0;
+}
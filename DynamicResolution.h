@@ -0,0 +1,53 @@
+#pragma once
+
+// --------------------------------------------------------
+// Picks a render scale (fraction of the window's width and
+// height) that keeps frame times near a target.
+//
+// Frame times are smoothed, and the scale only changes once
+// the smoothed time has left a band around the target: it
+// drops as soon as frames go over budget, but only rises
+// when there's clear headroom, so it doesn't flip back and
+// forth.  Since cost roughly follows the pixel count, the
+// new scale is the old one times the square root of
+// target / frame time, rounded to ScaleStep.  After a change
+// the average restarts, and nothing changes again for
+// CooldownFrames, so each decision is based on frames that
+// were actually rendered at the current scale.
+//
+// Only depends on the frame times it's given, so the same
+// trace always produces the same scales.
+// --------------------------------------------------------
+class DynamicResolution
+{
+public:
+	static const int CooldownFrames = 8;
+	static constexpr float ScaleStep = 0.05f;
+	static constexpr float Smoothing = 0.1f;		// Weight of each new frame in the average
+	static constexpr float RaiseThreshold = 0.85f;	// Raise when under this fraction of the target
+
+	DynamicResolution(float targetFrameTime, float minScale = 0.5f, float maxScale = 1.0f);
+
+	// Feeds in the last frame's time (seconds) and returns the
+	// scale to render the next frame at
+	float Update(float frameTime);
+
+	float GetScale() const { return scale; }
+	float GetAverageFrameTime() const { return averageFrameTime; }
+
+	float GetTargetFrameTime() const { return targetFrameTime; }
+	void SetTargetFrameTime(float frameTime) { targetFrameTime = frameTime; }
+
+	// Back to full scale, forgetting past frames
+	void Reset();
+
+private:
+	float targetFrameTime;
+	float minScale;
+	float maxScale;
+
+	float scale;
+	float averageFrameTime;
+	bool hasAverage;
+	int framesSinceChange;
+};
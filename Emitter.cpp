@@ -188,6 +188,7 @@ void Emitter::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera*
 
 	ps->SetShaderResourceView("particle", texture.Get());
 	ps->SetShader();
+	ps->FlushResources();
 
 	//draw the alive parts, wrapping vs contiguous
 	if (firstAliveIndex < firstDeadIndex) { //contiguous
@@ -48,46 +48,3 @@ bool Entity::IsCollidingWith(Entity& other)
 
 	return true;
 }
-
-void Entity::DrawObject(ID3D11DeviceContext* context, Camera* camera)
-{
-	auto ps = material->GetPixelShader();
-	auto vs = material->GetVertexShader();
-	// Set the vertex and pixel shaders to use for the next Draw() command
-	//  - These don't technically need to be set every frame
-	//  - Once you start applying different shaders to different objects,
-	//    you'll need to swap the current shaders before each draw
-	vs->SetShader();
-	ps->SetShader();
-
-
-
-	//Set the constant buffer
-	vs->SetFloat4("colorTint", material->GetColorTint());
-	vs->SetMatrix4x4("worldMatrix", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("viewMatrix", camera->GetViewMatrix());
-	vs->SetMatrix4x4("projectionMatrix", camera->GetProjectionMatrix());
-	
-	vs->CopyAllBufferData();
-
-	ps->SetFloat("reflectivity", material->GetReflectivity());
-	ps->SetSamplerState("samplerOptions", material->GetSamplerState().Get());
-	ps->SetShaderResourceView("diffuseTexture", material->GetShaderResource().Get());
-	
-	if (material->IsNormalMap()) {
-		ps->SetShaderResourceView("normalMap", material->GetNormalMap().Get());
-	}
-
-	ps->CopyAllBufferData();
-
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	//Draw them
-	context->DrawIndexed(
-		mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
-}
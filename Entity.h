@@ -14,7 +14,6 @@ public:
 	std::shared_ptr<Material> GetMaterial() const;
 
 	bool IsCollidingWith(Entity& other);
-	void DrawObject(ID3D11DeviceContext* context, Camera* camera);
 private:
 	std::shared_ptr<Mesh> mesh;
 	std::unique_ptr<Transform> transform;
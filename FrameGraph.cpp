@@ -0,0 +1,193 @@
+#include "FrameGraph.h"
+
+static bool IsWrite(FrameGraphAccess access)
+{
+	return access != FrameGraphAccess::ShaderRead;
+}
+
+void FrameGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+	passLive.clear();
+	steps.clear();
+}
+
+FrameGraphResource FrameGraph::CreateTexture(std::string name, const FrameGraphTextureDesc& desc)
+{
+	resources.push_back({ name, desc, true, false });
+	return (FrameGraphResource)(resources.size() - 1);
+}
+
+FrameGraphResource FrameGraph::ImportResource(std::string name)
+{
+	FrameGraphTextureDesc none = {};
+	resources.push_back({ name, none, false, false });
+	return (FrameGraphResource)(resources.size() - 1);
+}
+
+void FrameGraph::MarkOutput(FrameGraphResource resource)
+{
+	if (resource < resources.size())
+		resources[resource].Output = true;
+}
+
+FrameGraphPass& FrameGraph::AddPass(std::string name, std::function<void()> execute)
+{
+	FrameGraphPass pass;
+	pass.Name = name;
+	pass.Execute = execute;
+	passes.push_back(pass);
+	return passes.back();
+}
+
+bool FrameGraph::Compile()
+{
+	unsigned int passCount = (unsigned int)passes.size();
+	unsigned int resourceCount = (unsigned int)resources.size();
+	steps.clear();
+	passLive.assign(passCount, false);
+
+	// What each pass needs run before it: the last writer of
+	// anything it reads, and of anything it writes (written
+	// content is kept, e.g. particles blending onto the scene).
+	// Dependencies always point at earlier passes, so the
+	// declaration order is already a valid order to run them in
+	std::vector<std::vector<unsigned int>> dependencies(passCount);
+	std::vector<int> lastWriter(resourceCount, -1);
+
+	for (unsigned int p = 0; p < passCount; p++)
+	{
+		for (const FrameGraphPass::Use& use : passes[p].Uses)
+		{
+			if (use.Resource >= resourceCount)
+				return false;
+
+			int writer = lastWriter[use.Resource];
+			if (writer >= 0 && writer != (int)p)
+				dependencies[p].push_back((unsigned int)writer);
+		}
+
+		for (const FrameGraphPass::Use& use : passes[p].Uses)
+		{
+			if (IsWrite(use.Access))
+				lastWriter[use.Resource] = (int)p;
+		}
+	}
+
+	// Keep passes with side effects or that write an output,
+	// plus everything they depend on
+	std::vector<unsigned int> pending;
+	for (unsigned int p = 0; p < passCount; p++)
+	{
+		bool root = passes[p].SideEffects;
+		for (const FrameGraphPass::Use& use : passes[p].Uses)
+			root = root || (IsWrite(use.Access) && resources[use.Resource].Output);
+
+		if (root)
+		{
+			passLive[p] = true;
+			pending.push_back(p);
+		}
+	}
+	while (!pending.empty())
+	{
+		unsigned int p = pending.back();
+		pending.pop_back();
+		for (unsigned int dependency : dependencies[p])
+		{
+			if (!passLive[dependency])
+			{
+				passLive[dependency] = true;
+				pending.push_back(dependency);
+			}
+		}
+	}
+
+	for (unsigned int p = 0; p < passCount; p++)
+	{
+		if (passLive[p])
+		{
+			FrameGraphStep step;
+			step.Pass = p;
+			steps.push_back(step);
+		}
+	}
+
+	// Transient lifetimes: first and last step using each one
+	std::vector<int> firstUse(resourceCount, -1);
+	std::vector<int> lastUse(resourceCount, -1);
+	for (unsigned int s = 0; s < steps.size(); s++)
+	{
+		for (const FrameGraphPass::Use& use : passes[steps[s].Pass].Uses)
+		{
+			if (firstUse[use.Resource] < 0)
+				firstUse[use.Resource] = (int)s;
+			lastUse[use.Resource] = (int)s;
+		}
+	}
+	for (FrameGraphResource r = 0; r < resourceCount; r++)
+	{
+		if (resources[r].Transient && firstUse[r] >= 0)
+		{
+			steps[firstUse[r]].Acquire.push_back(r);
+			steps[lastUse[r]].Release.push_back(r);
+		}
+	}
+
+	// Binding hazards.  Reads stay bound until something writes
+	// the resource; outputs stay bound until the next pass that
+	// binds its own outputs
+	enum class BindState { None, Read, Output };
+	std::vector<BindState> bound(resourceCount, BindState::None);
+	for (FrameGraphStep& step : steps)
+	{
+		const FrameGraphPass& pass = passes[step.Pass];
+		bool bindsOutputs = false;
+		for (const FrameGraphPass::Use& use : pass.Uses)
+		{
+			if (IsWrite(use.Access) && bound[use.Resource] == BindState::Read)
+				step.UnbindShaderResources = true;
+			if (!IsWrite(use.Access) && bound[use.Resource] == BindState::Output)
+				step.UnbindOutputs = true;
+			if (use.Access == FrameGraphAccess::RenderTarget || use.Access == FrameGraphAccess::DepthStencil)
+				bindsOutputs = true;
+		}
+
+		if (bindsOutputs)
+		{
+			for (BindState& state : bound)
+			{
+				if (state == BindState::Output)
+					state = BindState::None;
+			}
+		}
+		if (step.UnbindShaderResources)
+		{
+			for (BindState& state : bound)
+			{
+				if (state == BindState::Read)
+					state = BindState::None;
+			}
+		}
+
+		for (const FrameGraphPass::Use& use : pass.Uses)
+			bound[use.Resource] = IsWrite(use.Access) ? BindState::Output : BindState::Read;
+	}
+
+	return true;
+}
+
+std::vector<FrameGraphAccess> FrameGraph::GetResourceAccesses(FrameGraphResource resource)
+{
+	std::vector<FrameGraphAccess> accesses;
+	for (const FrameGraphStep& step : steps)
+	{
+		for (const FrameGraphPass::Use& use : passes[step.Pass].Uses)
+		{
+			if (use.Resource == resource)
+				accesses.push_back(use.Access);
+		}
+	}
+	return accesses;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Index of a resource within one FrameGraph
+typedef unsigned int FrameGraphResource;
+
+// How a pass uses a resource
+enum class FrameGraphAccess
+{
+	ShaderRead,		// Sampled / read through an SRV
+	RenderTarget,	// Color output
+	DepthStencil,	// Depth output (or depth tested)
+	UnorderedAccess	// Read/write from a compute shader
+};
+
+// --------------------------------------------------------
+// Size and format of a transient texture.  Format is just
+// passed through to the executor (a DXGI_FORMAT for D3D11)
+// --------------------------------------------------------
+struct FrameGraphTextureDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Format;
+};
+
+// --------------------------------------------------------
+// One pass: what it touches, and what to run
+// --------------------------------------------------------
+struct FrameGraphPass
+{
+	struct Use
+	{
+		FrameGraphResource Resource;
+		FrameGraphAccess Access;
+	};
+
+	std::string Name;
+	std::vector<Use> Uses;
+	std::function<void()> Execute;
+	bool SideEffects = false; // Never culled, even if nothing reads its output
+
+	FrameGraphPass& Read(FrameGraphResource resource) { return Access(resource, FrameGraphAccess::ShaderRead); }
+	FrameGraphPass& Write(FrameGraphResource resource) { return Access(resource, FrameGraphAccess::RenderTarget); }
+	FrameGraphPass& Access(FrameGraphResource resource, FrameGraphAccess access)
+	{
+		Uses.push_back({ resource, access });
+		return *this;
+	}
+};
+
+// --------------------------------------------------------
+// One step of the compiled frame: a pass to run, plus what
+// the executor has to do around it
+// --------------------------------------------------------
+struct FrameGraphStep
+{
+	unsigned int Pass;
+
+	// Transient resources to create/reuse before the pass,
+	// and to give back once the pass is done with them
+	std::vector<FrameGraphResource> Acquire;
+	std::vector<FrameGraphResource> Release;
+
+	// Binding hazards: something this pass writes is still
+	// bound for reading (so reads must be unbound first), or
+	// something it reads is still bound as an output
+	bool UnbindShaderResources = false;
+	bool UnbindOutputs = false;
+};
+
+// --------------------------------------------------------
+// Declares a frame as passes reading and writing named
+// resources, then works out how to run it.
+//
+// Compile():
+//  - Works out which passes each pass depends on: the last
+//    writer of each resource it reads or writes (writes keep
+//    the existing content).  Passes run in the order they
+//    were declared, which always satisfies these.
+//  - Culls passes that nothing needs: only passes with side
+//    effects, passes writing an output, and (recursively)
+//    whatever those depend on are kept.
+//  - Gives each transient texture a lifetime, from its first
+//    to last use, so the executor can recycle it.
+//  - Flags passes that need inputs or outputs unbound first.
+//
+// Knows nothing about any graphics API - FrameGraphExecutor
+// runs the result with D3D11.
+// --------------------------------------------------------
+class FrameGraph
+{
+public:
+	// Clears all passes and resources, for building a new frame
+	void Reset();
+
+	// Transient textures are created by the executor for the
+	// span of passes that use them.  Imported resources (the
+	// back buffer, the main depth buffer) are provided by
+	// whoever runs the graph
+	FrameGraphResource CreateTexture(std::string name, const FrameGraphTextureDesc& desc);
+	FrameGraphResource ImportResource(std::string name);
+
+	// Outputs are what the frame is for - their writers are never culled
+	void MarkOutput(FrameGraphResource resource);
+
+	// The returned pass is valid until the next AddPass()
+	FrameGraphPass& AddPass(std::string name, std::function<void()> execute);
+
+	// False if a pass uses a resource that doesn't exist
+	bool Compile();
+
+	const std::vector<FrameGraphStep>& GetSteps() { return steps; }
+	const FrameGraphPass& GetPass(unsigned int index) { return passes[index]; }
+	unsigned int GetPassCount() { return (unsigned int)passes.size(); }
+	bool IsPassCulled(unsigned int index) { return !passLive[index]; }
+
+	const std::string& GetResourceName(FrameGraphResource resource) { return resources[resource].Name; }
+	bool IsTransient(FrameGraphResource resource) { return resources[resource].Transient; }
+	const FrameGraphTextureDesc& GetTextureDesc(FrameGraphResource resource) { return resources[resource].Desc; }
+
+	// Every way the live passes use a resource (for picking bind flags)
+	std::vector<FrameGraphAccess> GetResourceAccesses(FrameGraphResource resource);
+
+private:
+	struct Resource
+	{
+		std::string Name;
+		FrameGraphTextureDesc Desc;
+		bool Transient;
+		bool Output;
+	};
+
+	std::vector<Resource> resources;
+	std::vector<FrameGraphPass> passes;
+
+	std::vector<bool> passLive;
+	std::vector<FrameGraphStep> steps;
+};
@@ -0,0 +1,148 @@
+#include "FrameGraphExecutor.h"
+#include "SimpleShader.h"
+
+FrameGraphExecutor::FrameGraphExecutor(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, RenderTargetPool* pool)
+{
+	this->context = context;
+	this->pool = pool;
+}
+
+void FrameGraphExecutor::Import(FrameGraphResource resource, ID3D11RenderTargetView* rtv,
+	ID3D11DepthStencilView* dsv, ID3D11ShaderResourceView* srv)
+{
+	if (resource >= views.size())
+		views.resize(resource + 1);
+
+	views[resource].RTV = rtv;
+	views[resource].DSV = dsv;
+	views[resource].SRV = srv;
+	views[resource].UAV = 0;
+	views[resource].Pooled = 0;
+}
+
+void FrameGraphExecutor::Execute(FrameGraph& graph)
+{
+	for (const FrameGraphStep& step : graph.GetSteps())
+	{
+		const FrameGraphPass& pass = graph.GetPass(step.Pass);
+
+		// Transient textures, with bind flags for every way
+		// the frame uses them
+		bool missing = false;
+		for (FrameGraphResource resource : step.Acquire)
+		{
+			unsigned int bindFlags = 0;
+			for (FrameGraphAccess access : graph.GetResourceAccesses(resource))
+			{
+				if (access == FrameGraphAccess::ShaderRead) bindFlags |= D3D11_BIND_SHADER_RESOURCE;
+				if (access == FrameGraphAccess::RenderTarget) bindFlags |= D3D11_BIND_RENDER_TARGET;
+				if (access == FrameGraphAccess::DepthStencil) bindFlags |= D3D11_BIND_DEPTH_STENCIL;
+				if (access == FrameGraphAccess::UnorderedAccess) bindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+			}
+
+			const FrameGraphTextureDesc& desc = graph.GetTextureDesc(resource);
+			RenderTargetDesc targetDesc = { desc.Width, desc.Height, (DXGI_FORMAT)desc.Format, bindFlags };
+			RenderTarget* target = pool->Acquire(targetDesc);
+
+			Import(resource, target ? target->RTV.Get() : 0, target ? target->DSV.Get() : 0, target ? target->SRV.Get() : 0);
+			views[resource].UAV = target ? target->UAV.Get() : 0;
+			views[resource].Pooled = target;
+		}
+
+		for (const FrameGraphPass::Use& use : pass.Uses)
+		{
+			Views* v = Find(use.Resource);
+			missing = missing || !v || (graph.IsTransient(use.Resource) && !v->Pooled);
+		}
+
+		if (step.UnbindShaderResources)
+			UnbindShaderResources();
+		if (step.UnbindOutputs)
+			UnbindOutputs();
+
+		if (!missing)
+		{
+			// Bind the pass's outputs (if it has any)
+			std::vector<ID3D11RenderTargetView*> rtvs;
+			ID3D11DepthStencilView* dsv = 0;
+			for (const FrameGraphPass::Use& use : pass.Uses)
+			{
+				if (use.Access == FrameGraphAccess::RenderTarget)
+					rtvs.push_back(views[use.Resource].RTV);
+				else if (use.Access == FrameGraphAccess::DepthStencil)
+					dsv = views[use.Resource].DSV;
+			}
+			if (!rtvs.empty() || dsv)
+				context->OMSetRenderTargets((UINT)rtvs.size(), rtvs.empty() ? 0 : rtvs.data(), dsv);
+
+			if (pass.Execute)
+				pass.Execute();
+		}
+
+		for (FrameGraphResource resource : step.Release)
+		{
+			if (views[resource].Pooled)
+				pool->Release(views[resource].Pooled);
+			views[resource] = Views();
+		}
+	}
+
+	// Leave nothing bound that next frame might write to
+	UnbindShaderResources();
+	UnbindOutputs();
+	views.clear();
+}
+
+ID3D11RenderTargetView* FrameGraphExecutor::GetRTV(FrameGraphResource resource)
+{
+	Views* v = Find(resource);
+	return v ? v->RTV : 0;
+}
+
+ID3D11DepthStencilView* FrameGraphExecutor::GetDSV(FrameGraphResource resource)
+{
+	Views* v = Find(resource);
+	return v ? v->DSV : 0;
+}
+
+ID3D11ShaderResourceView* FrameGraphExecutor::GetSRV(FrameGraphResource resource)
+{
+	Views* v = Find(resource);
+	return v ? v->SRV : 0;
+}
+
+ID3D11UnorderedAccessView* FrameGraphExecutor::GetUAV(FrameGraphResource resource)
+{
+	Views* v = Find(resource);
+	return v ? v->UAV : 0;
+}
+
+FrameGraphExecutor::Views* FrameGraphExecutor::Find(FrameGraphResource resource)
+{
+	return resource < views.size() ? &views[resource] : 0;
+}
+
+// --------------------------------------------------------
+// Clears every pixel and compute shader SRV slot we use,
+// then tells SimpleShader its record of them is stale
+// --------------------------------------------------------
+void FrameGraphExecutor::UnbindShaderResources()
+{
+	ID3D11ShaderResourceView* none[16] = {};
+	context->PSSetShaderResources(0, 16, none);
+	context->CSSetShaderResources(0, 16, none);
+	ISimpleShader::InvalidateBoundResources();
+}
+
+// --------------------------------------------------------
+// Clears render targets, depth and compute shader UAVs.
+// A UAV that's still bound would stop the same texture
+// from being bound as an SRV (D3D quietly binds null)
+// --------------------------------------------------------
+void FrameGraphExecutor::UnbindOutputs()
+{
+	context->OMSetRenderTargets(0, 0, 0);
+
+	ID3D11UnorderedAccessView* none[D3D11_PS_CS_UAV_REGISTER_COUNT] = {};
+	context->CSSetUnorderedAccessViews(0, D3D11_PS_CS_UAV_REGISTER_COUNT, none, 0);
+}
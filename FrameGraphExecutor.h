@@ -0,0 +1,57 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+#include "FrameGraph.h"
+#include "RenderTargetPool.h"
+
+// --------------------------------------------------------
+// Runs a compiled FrameGraph with D3D11.
+//
+// Transient textures come from a RenderTargetPool, taken
+// just before their first pass and handed back after their
+// last.  Before each pass its render target and depth
+// writes are bound (in the order declared) and any hazards
+// the graph found are fixed by unbinding.  Passes look up
+// their resources' views through Get*().
+// --------------------------------------------------------
+class FrameGraphExecutor
+{
+public:
+	FrameGraphExecutor(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, RenderTargetPool* pool);
+
+	// Views for an imported resource, for this frame
+	void Import(FrameGraphResource resource, ID3D11RenderTargetView* rtv,
+		ID3D11DepthStencilView* dsv = 0, ID3D11ShaderResourceView* srv = 0);
+
+	// Runs a compiled graph.  Passes whose transient textures
+	// can't be created are skipped.  Everything is unbound
+	// afterwards, ready for next frame
+	void Execute(FrameGraph& graph);
+
+	// Valid while the graph is running
+	ID3D11RenderTargetView* GetRTV(FrameGraphResource resource);
+	ID3D11DepthStencilView* GetDSV(FrameGraphResource resource);
+	ID3D11ShaderResourceView* GetSRV(FrameGraphResource resource);
+	ID3D11UnorderedAccessView* GetUAV(FrameGraphResource resource);
+
+private:
+	struct Views
+	{
+		ID3D11RenderTargetView* RTV = 0;
+		ID3D11DepthStencilView* DSV = 0;
+		ID3D11ShaderResourceView* SRV = 0;
+		ID3D11UnorderedAccessView* UAV = 0;
+		RenderTarget* Pooled = 0;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	RenderTargetPool* pool;
+	std::vector<Views> views;
+
+	Views* Find(FrameGraphResource resource);
+	void UnbindShaderResources();
+	void UnbindOutputs();
+};
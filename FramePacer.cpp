@@ -0,0 +1,72 @@
+#include "FramePacer.h"
+
+#include <chrono>
+#include <thread>
+
+SystemFrameClock::SystemFrameClock()
+{
+	start = 0;
+	start = Now();
+}
+
+double SystemFrameClock::Now()
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration<double>(now).count() - start;
+}
+
+void SystemFrameClock::Sleep(double seconds)
+{
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+FramePacer::FramePacer(std::shared_ptr<FrameClock> clock)
+{
+	this->clock = clock ? clock : std::make_shared<SystemFrameClock>();
+	targetFrameRate = 0;
+	nextFrameTime = 0;
+	scheduled = false;
+	lastWaitTime = 0;
+}
+
+void FramePacer::SetTargetFrameRate(double framesPerSecond)
+{
+	targetFrameRate = framesPerSecond > 0 ? framesPerSecond : 0;
+	scheduled = false;
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	lastWaitTime = 0;
+	if (targetFrameRate <= 0)
+		return;
+
+	double period = 1.0 / targetFrameRate;
+	double start = clock->Now();
+
+	// First frame (or the rate changed): nothing to wait for yet
+	if (!scheduled)
+	{
+		nextFrameTime = start + period;
+		scheduled = true;
+		return;
+	}
+
+	// Way behind - start a new schedule from now
+	if (start - nextFrameTime > period)
+	{
+		nextFrameTime = start + period;
+		return;
+	}
+
+	double remaining = nextFrameTime - start;
+	if (remaining > SpinTime)
+		clock->Sleep(remaining - SpinTime);
+
+	double now = clock->Now();
+	while (now < nextFrameTime)
+		now = clock->Now();
+
+	lastWaitTime = now - start;
+	nextFrameTime += period;
+}
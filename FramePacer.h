@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+
+// --------------------------------------------------------
+// Where FramePacer gets time from.  The real one uses the
+// system's steady clock; tests can drive a fake one.
+//
+// A fake clock's Now() has to move forward on every call:
+// WaitForNextFrame() spins on Now() until the deadline, so a
+// clock that only moves on Sleep() would spin forever
+// --------------------------------------------------------
+class FrameClock
+{
+public:
+	virtual ~FrameClock() {}
+
+	virtual double Now() = 0;					// Seconds, from any fixed start
+	virtual void Sleep(double seconds) = 0;		// May oversleep (often by a millisecond or more)
+};
+
+class SystemFrameClock : public FrameClock
+{
+public:
+	SystemFrameClock();
+
+	double Now() override;
+	void Sleep(double seconds) override;
+
+private:
+	double start;
+};
+
+// --------------------------------------------------------
+// Limits the frame rate by holding each frame until its
+// slot comes up.
+//
+// Frames are scheduled one period apart (not one period
+// after the last one finished), so small delays don't add
+// up.  A frame that runs more than a whole period late
+// restarts the schedule instead of rushing to catch up.
+//
+// Waiting sleeps until SpinTime before the deadline, then
+// spins on the clock for the rest, since sleeping is only
+// accurate to a millisecond or so.
+// --------------------------------------------------------
+class FramePacer
+{
+public:
+	static constexpr double SpinTime = 0.002;
+
+	// Uses the system clock if none is given
+	FramePacer(std::shared_ptr<FrameClock> clock = nullptr);
+
+	// 0 (the default) doesn't limit at all
+	void SetTargetFrameRate(double framesPerSecond);
+	double GetTargetFrameRate() const { return targetFrameRate; }
+
+	// Blocks until it's time to start the next frame
+	void WaitForNextFrame();
+
+	// Time spent waiting in the last WaitForNextFrame()
+	double GetLastWaitTime() const { return lastWaitTime; }
+
+private:
+	std::shared_ptr<FrameClock> clock;
+	double targetFrameRate;
+	double nextFrameTime;
+	bool scheduled;
+	double lastWaitTime;
+};
@@ -0,0 +1,116 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+Frustum::Frustum()
+{
+	// Everything's inside until we're given a camera
+	for (int i = 0; i < 6; i++)
+		planes[i] = XMFLOAT4(0, 0, 0, 1);
+}
+
+// --------------------------------------------------------
+// Gribb/Hartmann plane extraction.  With row vectors,
+// clip = p * M, so each plane is a sum or difference of
+// the matrix's columns
+// --------------------------------------------------------
+void Frustum::SetFromViewProjection(XMFLOAT4X4 view, XMFLOAT4X4 projection)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+	XMVECTOR col0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR col1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR col2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR col3 = XMVectorSet(m._14, m._24, m._34, m._44);
+
+	XMVECTOR extracted[6] =
+	{
+		XMVectorAdd(col3, col0),		// Left
+		XMVectorSubtract(col3, col0),	// Right
+		XMVectorAdd(col3, col1),		// Bottom
+		XMVectorSubtract(col3, col1),	// Top
+		col2,							// Near
+		XMVectorSubtract(col3, col2),	// Far
+	};
+
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(extracted[i]));
+}
+
+// --------------------------------------------------------
+// A box is outside if it's entirely behind any one plane,
+// i.e. its center's distance plus its projected radius
+// (extents dotted with the absolute normal) is negative.
+// Each iteration handles four boxes, one per vector lane.
+// --------------------------------------------------------
+void Frustum::TestBoxes(const BoundsSoA& bounds, size_t count, uint8_t* visible) const
+{
+	XMVECTOR zero = XMVectorZero();
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		// Full batches load straight from the arrays; a short
+		// last batch is padded with copies of its first box
+		size_t lanes = count - i < 4 ? count - i : 4;
+		const float* source[6] = { bounds.CenterX, bounds.CenterY, bounds.CenterZ, bounds.ExtentX, bounds.ExtentY, bounds.ExtentZ };
+		XMVECTOR v[6];
+		for (int s = 0; s < 6; s++)
+		{
+			if (lanes == 4)
+			{
+				v[s] = XMLoadFloat4((const XMFLOAT4*)&source[s][i]);
+			}
+			else
+			{
+				XMFLOAT4 padded(source[s][i], source[s][i], source[s][i], source[s][i]);
+				for (size_t lane = 1; lane < lanes; lane++)
+					(&padded.x)[lane] = source[s][i + lane];
+				v[s] = XMLoadFloat4(&padded);
+			}
+		}
+
+		XMVECTOR cx = v[0], cy = v[1], cz = v[2];
+		XMVECTOR ex = v[3], ey = v[4], ez = v[5];
+
+		XMVECTOR inside = XMVectorTrueInt();
+		for (int p = 0; p < 6; p++)
+		{
+			XMVECTOR nx = XMVectorReplicate(planes[p].x);
+			XMVECTOR ny = XMVectorReplicate(planes[p].y);
+			XMVECTOR nz = XMVectorReplicate(planes[p].z);
+			XMVECTOR d = XMVectorReplicate(planes[p].w);
+
+			XMVECTOR distance = XMVectorMultiplyAdd(nx, cx, XMVectorMultiplyAdd(ny, cy, XMVectorMultiplyAdd(nz, cz, d)));
+			XMVECTOR radius = XMVectorMultiplyAdd(XMVectorAbs(nx), ex,
+				XMVectorMultiplyAdd(XMVectorAbs(ny), ey, XMVectorMultiply(XMVectorAbs(nz), ez)));
+
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorAdd(distance, radius), zero));
+		}
+
+		XMUINT4 result;
+		XMStoreUInt4(&result, inside);
+		const uint32_t* lane = &result.x;
+		for (size_t l = 0; l < lanes; l++)
+			visible[i + l] = lane[l] ? 1 : 0;
+	}
+}
+
+void Frustum::TransformBox(XMFLOAT3 localMin, XMFLOAT3 localMax, XMFLOAT4X4 world, XMFLOAT3* center, XMFLOAT3* extents)
+{
+	XMVECTOR min = XMLoadFloat3(&localMin);
+	XMVECTOR max = XMLoadFloat3(&localMax);
+	XMVECTOR localCenter = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+	XMVECTOR localExtents = XMVectorScale(XMVectorSubtract(max, min), 0.5f);
+
+	XMMATRIX m = XMLoadFloat4x4(&world);
+	XMStoreFloat3(center, XMVector3Transform(localCenter, m));
+
+	// Each world axis gets the local extents projected
+	// through the absolute rotation/scale rows
+	XMVECTOR worldExtents =
+		XMVectorMultiplyAdd(XMVectorSplatX(localExtents), XMVectorAbs(m.r[0]),
+		XMVectorMultiplyAdd(XMVectorSplatY(localExtents), XMVectorAbs(m.r[1]),
+		XMVectorMultiply(XMVectorSplatZ(localExtents), XMVectorAbs(m.r[2]))));
+	XMStoreFloat3(extents, worldExtents);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Bounding boxes in structure-of-arrays form, so four boxes'
+// worth of one component can be loaded in a single vector
+// --------------------------------------------------------
+struct BoundsSoA
+{
+	const float* CenterX;
+	const float* CenterY;
+	const float* CenterZ;
+	const float* ExtentX;
+	const float* ExtentY;
+	const float* ExtentZ;
+};
+
+// --------------------------------------------------------
+// The six planes of a camera's view volume, for culling
+// world space bounding boxes that are entirely outside it
+// --------------------------------------------------------
+class Frustum
+{
+public:
+	Frustum();
+
+	// Extracts the planes from view * projection (D3D style
+	// clip space, so the near plane is at z = 0)
+	void SetFromViewProjection(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection);
+
+	// Tests count axis aligned boxes, four at a time, setting
+	// visible[i] to 1 if box i is at least partly inside
+	void TestBoxes(const BoundsSoA& bounds, size_t count, uint8_t* visible) const;
+
+	// World space box around a local space box (Arvo's method)
+	static void TransformBox(DirectX::XMFLOAT3 localMin, DirectX::XMFLOAT3 localMax, DirectX::XMFLOAT4X4 world,
+		DirectX::XMFLOAT3* center, DirectX::XMFLOAT3* extents);
+
+private:
+	// Normals point into the frustum
+	DirectX::XMFLOAT4 planes[6];
+};
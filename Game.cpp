@@ -1,5 +1,6 @@
 #include "Game.h"
 #include "Vertex.h"
+#include "BufferStructs.h"
 #include <iostream>
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
@@ -8,6 +9,11 @@
 // For the DirectX Math library
 using namespace DirectX;
 
+// Motion blur settings
+static const unsigned int VelocityTileSize = 16;	// Pixels per side of a velocity tile
+static const int MotionBlurSamples = 8;
+static const float MaxMotionBlurPixels = 32.0f;
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -44,6 +50,10 @@ Game::~Game()
 	// we don't need to explicitly clean up those DirectX objects
 	// - If we weren't using smart pointers, we'd need
 	//   to call Release() on each DirectX object
+
+	// The shared input layouts are owned by SimpleShader's cache,
+	// so drop its references while the device is still around
+	SimpleVertexShader::ReleaseInputLayoutCache();
 }
 
 // --------------------------------------------------------
@@ -52,11 +62,15 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::Init()
 {
-	// Helper methods for loading shaders, creating some basic
-	// geometry to draw and some simple camera matrices.
-	//  - You'll be expanding and/or replacing these later
+	// Queue up all of our shaders, meshes and textures so the
+	// file reads and CPU work happen on worker threads, then wait
+	// for them (creating device resources as each one finishes)
+	threadPool = std::make_unique<ThreadPool>();
+	assetLoader = std::make_unique<AssetLoader>(device, context, threadPool.get());
 	LoadShaders();
 	CreateBasicGeometry();
+	assetLoader->Finish();
+	CreateEntities();
 
 	dir1.ambientColor = XMFLOAT3(0.1f, 0.0f, 0.05f);
 	dir1.diffuseColor = XMFLOAT3(1, 0, 0.5f);
@@ -73,6 +87,11 @@ void Game::Init()
 	point1.ambientColor = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	point1.diffuseColor = XMFLOAT3(0, 0, 1);
 	point1.position = XMFLOAT3(0.1f, 0, 0);
+	point1.range = 30.0f;
+
+	fogColor = XMFLOAT3(0.4f, 0.6f, 0.75f);
+	fogStart = 10.0f;
+	fogEnd = 40.0f;
 
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
@@ -80,6 +99,26 @@ void Game::Init()
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	camera = std::make_unique<Camera>((float)this->width / this->height);
+	clusteredLighting = std::make_unique<ClusteredLighting>(device, threadPool.get());
+	renderQueue = std::make_unique<RenderQueue>(device);
+	renderTargetPool = std::make_unique<RenderTargetPool>(device);
+	frameGraph = std::make_unique<FrameGraph>();
+	frameGraphExecutor = std::make_unique<FrameGraphExecutor>(context, renderTargetPool.get());
+	dynamicResolution = std::make_unique<DynamicResolution>(1.0f / 60.0f);
+	occlusionCuller = std::make_unique<OcclusionCuller>(256, 128, threadPool.get());
+	renderQueue->SetOcclusionCuller(occlusionCuller.get());
+	prePassKeyDown = false;
+	blurKeyDown = false;
+	for (bool& keyDown : postKeysDown)
+		keyDown = false;
+
+	// Cap the frame rate rather than rendering frames nobody
+	// sees, and read input as late as possible
+	SetTargetFrameRate(144.0);
+	SetLowLatencyMode(true);
+
+	// Simulate at a steady 60Hz, whatever the frame rate
+	SetFixedTimeStep(1.0f / 60.0f);
 
 	// for storing projectiles
 	// Keep track of projectiles on screen 
@@ -89,10 +128,6 @@ void Game::Init()
 	blurAmount = 0;
 
 	//Make particle system
-	//getTexture
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/particle.jpg").c_str(), 0, particleTexture.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/particle-round.png").c_str(), 0, round_particleTexture.GetAddressOf());
-
 	//Create depth state
 	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
 	dsDesc.DepthEnable = true;
@@ -141,66 +176,60 @@ void Game::Init()
 
 	fireRate = 0.5f;
 	lastShot = 1.0f;
-
-	ResizePostProcessResources();
 }
 
 // --------------------------------------------------------
-// Loads shaders from compiled shader object (.cso) files
-// and also created the Input Layout that describes our 
-// vertex data to the rendering pipeline. 
-// - Input Layout creation is done here because it must 
-//    be verified against vertex shader byte code
-// - We'll have that byte code already loaded below
+// Queues shaders from compiled shader object (.cso) files.
+// - Each SimpleVertexShader reflects its own Input Layout, and
+//    shaders with identical inputs (every VertexShader variant)
+//    share a single cached layout
+// - The lit shaders are permutation sets: each material's
+//    features pick a variant, built with the project (see the
+//    ShaderVariant items in the .vcxproj)
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"VertexShader.cso").c_str());
+	std::vector<ShaderFeature> vsFeatures = {
+		{ "NORMAL_MAP", MATERIAL_FEATURE_NORMAL_MAP },
+		{ "INSTANCED", MATERIAL_FEATURE_INSTANCED } };
+	std::vector<ShaderFeature> psFeatures = {
+		{ "NORMAL_MAP", MATERIAL_FEATURE_NORMAL_MAP },
+		{ "POINT_LIGHTS", MATERIAL_FEATURE_POINT_LIGHTS },
+		{ "FOG", MATERIAL_FEATURE_FOG } };
+
+	litVertexShaders = std::make_shared<ShaderPermutations>(device, context, ShaderStage::Vertex,
+		GetFullPathTo_Wide(L"../../VertexShader.hlsl"), GetFullPathTo_Wide(L"VertexShader"), vsFeatures);
+	litPixelShaders = std::make_shared<ShaderPermutations>(device, context, ShaderStage::Pixel,
+		GetFullPathTo_Wide(L"../../PixelShader.hlsl"), GetFullPathTo_Wide(L"PixelShader"), psFeatures);
+
+	assetLoader->LoadVertexShader("ParticleVS", GetFullPathTo_Wide(L"ParticleVS.cso"));
+	assetLoader->LoadPixelShader("ParticlePS", GetFullPathTo_Wide(L"ParticlePS.cso"));
 
-	pixelShader = std::make_shared<SimplePixelShader>(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"PixelShader.cso").c_str());
-
-	vertexShaderNormalMap = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"VertexShaderNormal.cso").c_str());
-
-	pixelShaderNormalMap = std::make_shared<SimplePixelShader>(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"PixelShaderNormal.cso").c_str());
-
-	particleVS = std::make_shared<SimpleVertexShader>(
-		device.Get(),
-		context.Get(),
-		GetFullPathTo_Wide(L"ParticleVS.cso").c_str());
-
-	particlePS = std::make_shared<SimplePixelShader>(
-		device.Get(),
-		context.Get(),
-		GetFullPathTo_Wide(L"ParticlePS.cso").c_str());
-		
 	//********Post Processing *****************
-	ppVS = std::make_shared<SimpleVertexShader>(
-		device.Get(),
-		context.Get(),
-		GetFullPathTo_Wide(L"PostProcessVS.cso").c_str());
-
-	ppPS = std::make_shared<SimplePixelShader>(
-		device.Get(),
-		context.Get(),
-		GetFullPathTo_Wide(L"PostProcessPS.cso").c_str());
-
+	assetLoader->LoadVertexShader("PostProcessVS", GetFullPathTo_Wide(L"PostProcessVS.cso"));
+	assetLoader->LoadPixelShader("CopyPS", GetFullPathTo_Wide(L"CopyPS.cso"));
+	assetLoader->LoadPixelShader("BlurPS", GetFullPathTo_Wide(L"BlurPS.cso"));
+	if (dxFeatureLevel >= D3D_FEATURE_LEVEL_11_0)
+		assetLoader->LoadComputeShader("BlurCS", GetFullPathTo_Wide(L"BlurCS.cso"));
+	assetLoader->LoadPixelShader("VelocityTilesPS", GetFullPathTo_Wide(L"VelocityTilesPS.cso"));
+	postStack = std::make_unique<PostProcessStack>(device, context,
+		GetFullPathTo_Wide(L"../../UberPostPS.hlsl"), GetFullPathTo_Wide(L"UberPostPS"));
+	postStack->GetSettings().Saturation = 1.1f;
+	postStack->GetSettings().Contrast = 1.05f;
+	postStack->GetSettings().ColorFilter = XMFLOAT3(1.0f, 0.97f, 0.92f);
 }
 
 
 
 // --------------------------------------------------------
-// Creates the geometry we're going to draw - a single triangle for now
+// Queues the meshes, textures and materials we're going to draw
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	auto cylinderMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device);
-	auto cubeMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device);
-	auto helixMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device);
-	sphereMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device);
+	assetLoader->LoadMesh("cylinder", GetFullPathTo("../../Assets/Models/cylinder.obj"));
+	assetLoader->LoadMesh("cube", GetFullPathTo("../../Assets/Models/cube.obj"));
+	assetLoader->LoadMesh("helix", GetFullPathTo("../../Assets/Models/helix.obj"));
+	assetLoader->LoadMesh("sphere", GetFullPathTo("../../Assets/Models/sphere.obj"));
 
 	//Make Materials
 	/*auto redMaterial = std::make_shared<Material>(XMFLOAT4(1.0f, 0.1f, 0.1f, 1.0f), 64, vertexShader, pixelShader);
@@ -209,22 +238,12 @@ void Game::CreateBasicGeometry()
 
 	auto whiteMaterial = std::make_shared<Material>(XMFLOAT4(1, 1, 1 , 1.0f), 64, vertexShader, pixelShader);*/
 
-	auto hResult = CreateWICTextureFromFile(device.Get(),
-		context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/brass.jpg").c_str(),
-		nullptr, brassTexture.GetAddressOf());
-
-
-	hResult = CreateWICTextureFromFile(device.Get(),
-		context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/rock.png").c_str(),
-		nullptr, rockTexture.GetAddressOf());
-
-	hResult = CreateWICTextureFromFile(device.Get(),
-		context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/target.png").c_str(),
-		nullptr, targetTexture.GetAddressOf());
-
-	hResult = CreateWICTextureFromFile(device.Get(),
-		context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/rock_normals.png").c_str(),
-		nullptr, rockTextureNMap.GetAddressOf());
+	assetLoader->LoadTexture("brass", GetFullPathTo_Wide(L"../../Assets/Textures/brass.jpg"));
+	assetLoader->LoadTexture("rock", GetFullPathTo_Wide(L"../../Assets/Textures/rock.png"));
+	assetLoader->LoadTexture("target", GetFullPathTo_Wide(L"../../Assets/Textures/target.png"));
+	assetLoader->LoadTexture("rock_normals", GetFullPathTo_Wide(L"../../Assets/Textures/rock_normals.png"));
+	assetLoader->LoadTexture("particle", GetFullPathTo_Wide(L"../../Assets/Textures/particle.jpg"));
+	assetLoader->LoadTexture("particle-round", GetFullPathTo_Wide(L"../../Assets/Textures/particle-round.png"));
 
 
 	D3D11_SAMPLER_DESC sampDescription = {};
@@ -236,10 +255,79 @@ void Game::CreateBasicGeometry()
 	sampDescription.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&sampDescription, samplerState.GetAddressOf());
 
-	brassMat = std::make_shared<Material>(XMFLOAT4(1, 1, 1.0f, 1.0f), 0, brassTexture, samplerState, vertexShader, pixelShader);
-	auto rockMat = std::make_shared<Material>(XMFLOAT4(1, 1, 1.0f, 1.0f), 64.0f, rockTexture, samplerState, vertexShader, pixelShader);
-	auto targetMat = std::make_shared<Material>(XMFLOAT4(1, 1, 1.0f, 1.0f), 64.0f, targetTexture, samplerState, vertexShader, pixelShader);
-	auto rockMatNMap = std::make_shared<Material>(XMFLOAT4(1, 1, 1.0f, 1.0f), 64.0f, rockTexture, samplerState, vertexShaderNormalMap, pixelShaderNormalMap, rockTextureNMap);
+	// Post processing reads between texels, and shouldn't wrap
+	D3D11_SAMPLER_DESC postSampDescription = {};
+	postSampDescription.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	postSampDescription.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	postSampDescription.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	postSampDescription.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	postSampDescription.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&postSampDescription, postSamplerState.GetAddressOf());
+
+	// Materials are created once their textures are ready (and the
+	// normal map feature is added for any that have a normal map)
+	unsigned int litFeatures = MATERIAL_FEATURE_POINT_LIGHTS;
+	MaterialDesc brassDesc = { XMFLOAT4(1, 1, 1.0f, 1.0f), 0, "brass", "", "", "", samplerState, litVertexShaders, litPixelShaders, litFeatures };
+	MaterialDesc rockDesc = { XMFLOAT4(1, 1, 1.0f, 1.0f), 64.0f, "rock", "", "", "", samplerState, litVertexShaders, litPixelShaders, litFeatures };
+	MaterialDesc targetDesc = { XMFLOAT4(1, 1, 1.0f, 1.0f), 64.0f, "target", "", "", "", samplerState, litVertexShaders, litPixelShaders, litFeatures };
+	MaterialDesc rockNMapDesc = { XMFLOAT4(1, 1, 1.0f, 1.0f), 64.0f, "rock", "rock_normals", "", "", samplerState, litVertexShaders, litPixelShaders, litFeatures };
+	assetLoader->LoadMaterial("brass", brassDesc);
+	assetLoader->LoadMaterial("rock", rockDesc);
+	assetLoader->LoadMaterial("target", targetDesc);
+	assetLoader->LoadMaterial("rockNMap", rockNMapDesc);
+}
+
+// --------------------------------------------------------
+// Grabs the loaded assets and creates the entities using them
+// --------------------------------------------------------
+void Game::CreateEntities()
+{
+	particleVS = assetLoader->GetVertexShader("ParticleVS");
+	particlePS = assetLoader->GetPixelShader("ParticlePS");
+	ppVS = assetLoader->GetVertexShader("PostProcessVS");
+	copyPS = assetLoader->GetPixelShader("CopyPS");
+	blurPS = assetLoader->GetPixelShader("BlurPS");
+	blurCS = assetLoader->GetComputeShader("BlurCS"); // Null below feature level 11.0
+	velocityTilesPS = assetLoader->GetPixelShader("VelocityTilesPS");
+
+	brassTexture = assetLoader->GetTexture("brass");
+	rockTexture = assetLoader->GetTexture("rock");
+	targetTexture = assetLoader->GetTexture("target");
+	rockTextureNMap = assetLoader->GetTexture("rock_normals");
+	particleTexture = assetLoader->GetTexture("particle");
+	round_particleTexture = assetLoader->GetTexture("particle-round");
+
+	auto cylinderMesh = assetLoader->GetMesh("cylinder");
+	if (cylinderMesh && cylinderMesh->GetCollider())
+	{
+		// The cylinders stand along Y, so a box a bit narrower
+		// than their radius stays inside the curved sides
+		XMFLOAT3 min = cylinderMesh->GetCollider()->GetMin();
+		XMFLOAT3 max = cylinderMesh->GetCollider()->GetMax();
+		targetOccluder = OccluderMesh::MakeBox(
+			XMFLOAT3(min.x * 0.65f, min.y, min.z * 0.65f),
+			XMFLOAT3(max.x * 0.65f, max.y, max.z * 0.65f));
+	}
+	sphereMesh = assetLoader->GetMesh("sphere");
+
+	brassMat = assetLoader->GetMaterial("brass");
+	auto targetMat = assetLoader->GetMaterial("target");
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Catch any drift between our constant buffer structs and the
+	// shaders (checking every variant the materials have loaded)
+	for (auto& vs : litVertexShaders->GetLoadedVertexShaders())
+	{
+		// Instanced variants take everything per instance
+		if (!vs->GetPerInstanceCompatible() && !vs->ValidateStruct<VertexShaderExternalData>("ExternalData"))
+			printf("VertexShaderExternalData doesn't match the vertex shaders' ExternalData!\n");
+	}
+	for (auto& ps : litPixelShaders->GetLoadedPixelShaders())
+	{
+		if (!ps->ValidateStruct<PixelShaderExternalData>("ExternalData"))
+			printf("PixelShaderExternalData doesn't match the pixel shaders' ExternalData!\n");
+	}
+#endif
 
 	//Make Targets, each divided into 3 rows.  Rotation is commented out until I get a texture that applies to the top of the cylinders
 	targets = std::vector<std::shared_ptr<Target>>();
@@ -306,67 +394,85 @@ void Game::OnResize()
 	if (camera != nullptr) {
 		camera->UpdateProjectionMatrix((float)this->width / this->height);
 	}
-
-	ResizePostProcessResources();
 }
 
 
-//Creates and resizes the triangle for Post Processing
-void Game::ResizePostProcessResources()
+
+// --------------------------------------------------------
+// Adds a point light that fades out over its duration
+// --------------------------------------------------------
+void Game::AddLightFlash(XMFLOAT3 position, XMFLOAT3 color, float range, float duration)
 {
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = width;
-	textureDesc.Height = height;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // Will render to it and sample from it!
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	ID3D11Texture2D* ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, &ppTexture);
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-	device->CreateRenderTargetView(ppTexture, &rtvDesc, blurRTV.ReleaseAndGetAddressOf());
-
-	// Create the Shader Resource View
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = textureDesc.Format;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-
-	device->CreateShaderResourceView(ppTexture, &srvDesc, ppSRV.ReleaseAndGetAddressOf());
-
-	// We don't need the texture reference itself no mo'
-	ppTexture->Release();
+	LightFlash flash = {};
+	flash.Light.diffuseColor = color;
+	flash.Light.position = position;
+	flash.Light.range = range;
+	flash.Duration = duration;
+	flash.Age = 0;
+	lightFlashes.push_back(flash);
 }
 
 // --------------------------------------------------------
-// Update your game here - user input, move objects, AI, etc.
+// Once a frame, before the simulation ticks - the camera
+// and toggles, which should respond at the frame rate
 // --------------------------------------------------------
-void Game::Update(float deltaTime, float totalTime)
+void Game::UpdateFrame(float deltaTime, float totalTime)
 {
 	// Quit if the escape key is pressed
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 
+	camera->Update(deltaTime, this->hWnd);
+
+	// Toggle the depth pre-pass on each press
+	bool prePassKey = (GetAsyncKeyState('P') & 0x8000) != 0;
+	if (prePassKey && !prePassKeyDown)
+		renderQueue->SetDepthPrePass(!renderQueue->GetDepthPrePass());
+	prePassKeyDown = prePassKey;
+
+	// Toggle the full screen blur on each press
+	bool blurKey = (GetAsyncKeyState('B') & 0x8000) != 0;
+	if (blurKey && !blurKeyDown)
+		blurAmount = blurAmount > 0 ? 0 : 7;
+	blurKeyDown = blurKey;
+
+	// Toggle post effects: T tonemapping, G color grading, V vignette
+	const int postKeys[] = { 'T', 'G', 'V' };
+	const unsigned int postKeyEffects[] = { POST_EFFECT_TONEMAP, POST_EFFECT_COLOR_GRADING, POST_EFFECT_VIGNETTE };
+	for (int i = 0; i < 3; i++)
+	{
+		bool postKey = (GetAsyncKeyState(postKeys[i]) & 0x8000) != 0;
+		if (postKey && !postKeysDown[i])
+			postStack->SetEffectEnabled(postKeyEffects[i], !postStack->IsEffectEnabled(postKeyEffects[i]));
+		postKeysDown[i] = postKey;
+	}
+}
+
+// --------------------------------------------------------
+// Update your game here - move objects, AI, etc.  Runs at
+// the fixed time step, so deltaTime is always the same
+// --------------------------------------------------------
+void Game::Update(float deltaTime, float totalTime)
+{
+	// Draw() blends from where things are now
+	for (size_t i = 0; i < targets.size(); i++)
+		targets[i]->GetTransform()->StorePreviousState();
+	for (size_t i = 0; i < projectiles.size(); i++)
+		projectiles[i]->GetTransform()->StorePreviousState();
+
 	//Draw the entities
 	for (size_t i = 0; i < targets.size(); i++)
 	{
 		targets[i]->Update(deltaTime);//Move the targets
 	}
 
-	camera->Update(deltaTime, this->hWnd);
+	// Fade out and remove finished flashes
+	for (int i = (int)lightFlashes.size() - 1; i >= 0; i--)
+	{
+		lightFlashes[i].Age += deltaTime;
+		if (lightFlashes[i].Age >= lightFlashes[i].Duration)
+			lightFlashes.erase(lightFlashes.begin() + i);
+	}
 
 	// -- SHOOTING --
 
@@ -386,6 +492,8 @@ void Game::Update(float deltaTime, float totalTime)
 		gunfire_emitter->SetPosition(camera->GetTransform()->GetPosition().x, camera->GetTransform()->GetPosition().y, camera->GetTransform()->GetPosition().z); //get camera position
 		gunfire_emitter->SetStartVelocity(camera->GetViewMatrix()._13, camera->GetViewMatrix()._23, camera->GetViewMatrix()._33); //get front of the camera
 		gunfire_emitter->Reset();
+
+		AddLightFlash(camera->GetTransform()->GetPosition(), XMFLOAT3(1.0f, 0.7f, 0.3f), 6.0f, 0.1f);
 	}
 
 	lastShot += deltaTime;
@@ -432,6 +540,8 @@ void Game::Update(float deltaTime, float totalTime)
 	if (!targets.empty()) {
 		for (int i = targets.size() - 1; i >= 0; i--) {
 			if (targets[i]->isDead) {
+				AddLightFlash(targets[i]->GetTransform()->GetPosition(), XMFLOAT3(1.0f, 0.3f, 0.2f), 8.0f, 0.4f);
+
 				//set an emitter onto the target
 				bool makeNew = true;
 				for (int j = 0; j < hitEmitters.size(); j++)
@@ -473,15 +583,6 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 	}
 
-
-	// decide the blur amount
-	// changes depending on if the camera is moving
-	if (camera.get()->GetDidCameraChange()) {
-		blurAmount = 7;
-	}
-	else {
-		blurAmount = 0;
-	}
 	
 	gunfire_emitter->Update(deltaTime);
 	for (int i = 0; i < hitEmitters.size(); i++)
@@ -494,6 +595,176 @@ void Game::Update(float deltaTime, float totalTime)
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
+{
+	// The frame, as passes over named resources.  The graph
+	// drops anything unused, gets the scene texture from the
+	// pool and unbinds inputs/outputs between passes
+	frameGraph->Reset();
+	FrameGraphResource backBuffer = frameGraph->ImportResource("BackBuffer");
+	FrameGraphResource depth = frameGraph->ImportResource("Depth");
+	frameGraph->MarkOutput(backBuffer);
+
+	// Render the scene into the top left of its targets, at
+	// whatever scale keeps us within the frame time budget.
+	// The post pass scales it back up
+	//  - Time the frame limiter spent sleeping isn't work, so
+	//    it shouldn't push the resolution down
+	float scale = dynamicResolution->Update(deltaTime - GetLastFrameWaitTime());
+	unsigned int renderWidth = (std::max)((unsigned int)(width * scale + 0.5f), 1u);
+	unsigned int renderHeight = (std::max)((unsigned int)(height * scale + 0.5f), 1u);
+	XMFLOAT2 renderScale((float)renderWidth / width, (float)renderHeight / height);
+
+	// Only render offscreen when there's a post effect to apply
+	// (or the scene needs scaling); otherwise the scene goes
+	// straight to the back buffer.  Motion blur is only needed
+	// while the camera moves, and tonemapping needs a scene
+	// brighter than 1
+	unsigned int effects = postStack->GetEffects();
+	if (camera->GetDidCameraChange())
+		effects |= POST_EFFECT_MOTION_BLUR;
+
+	bool motionBlur = (effects & POST_EFFECT_MOTION_BLUR) != 0;
+	bool gaussianBlur = blurAmount > 0;
+	bool scaled = renderWidth != width || renderHeight != height;
+	bool postProcess = effects != 0 || gaussianBlur || scaled;
+
+	DXGI_FORMAT sceneFormat = (effects & POST_EFFECT_TONEMAP) ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+	FrameGraphTextureDesc sceneDesc = { (unsigned int)width, (unsigned int)height, (unsigned int)sceneFormat };
+	FrameGraphResource scene = postProcess ? frameGraph->CreateTexture("Scene", sceneDesc) : backBuffer;
+
+	frameGraph->AddPass("Scene", [=]() { DrawScene(frameGraphExecutor->GetRTV(scene), frameGraphExecutor->GetDSV(depth), renderWidth, renderHeight); })
+		.Write(scene)
+		.Access(depth, FrameGraphAccess::DepthStencil);
+
+	frameGraph->AddPass("Particles", [=]() { DrawParticles(); })
+		.Write(scene)
+		.Access(depth, FrameGraphAccess::DepthStencil);
+
+	FrameGraphResource color = scene;
+	XMFLOAT2 colorUVScale = renderScale;
+	if (gaussianBlur)
+	{
+		// Blur at half or quarter size, so the number of taps
+		// stays about the same whatever the radius
+		int levels = (std::max)(1, BlurKernel::GetDownsampleLevels(blurAmount, 2));
+		int radius = (blurAmount + (1 << levels) - 1) >> levels;
+		if (!blurKernel || blurKernel->GetRadius() != radius)
+			blurKernel = std::make_unique<BlurKernel>(radius);
+
+		// The first downsample only reads the part of the scene
+		// that was rendered, so everything after fills its texture
+		FrameGraphTextureDesc smallDesc = sceneDesc;
+		FrameGraphResource source = color;
+		for (int i = 0; i < levels; i++)
+		{
+			smallDesc.Width = (std::max)(smallDesc.Width / 2, 1u);
+			smallDesc.Height = (std::max)(smallDesc.Height / 2, 1u);
+			FrameGraphResource downsampled = frameGraph->CreateTexture("Downsample", smallDesc);
+
+			XMFLOAT2 sourceUVScale = i == 0 ? renderScale : XMFLOAT2(1, 1);
+			frameGraph->AddPass("Downsample", [=]() {
+					copyPS->SetFloat2("uvScale", sourceUVScale);
+					DrawFullscreen(copyPS, frameGraphExecutor->GetSRV(source), smallDesc.Width, smallDesc.Height);
+				})
+				.Read(source)
+				.Write(downsampled);
+			source = downsampled;
+		}
+
+		// Compute shaders (when supported) read each texel once
+		// per group instead of once per tap
+		FrameGraphResource blurredX = frameGraph->CreateTexture("BlurHorizontal", smallDesc);
+		FrameGraphResource blurred = frameGraph->CreateTexture("BlurVertical", smallDesc);
+		if (blurCS)
+		{
+			frameGraph->AddPass("BlurHorizontal", [=]() {
+					DispatchBlur(frameGraphExecutor->GetSRV(source), frameGraphExecutor->GetUAV(blurredX), smallDesc.Width, smallDesc.Height, true);
+				})
+				.Read(source)
+				.Access(blurredX, FrameGraphAccess::UnorderedAccess);
+
+			frameGraph->AddPass("BlurVertical", [=]() {
+					DispatchBlur(frameGraphExecutor->GetSRV(blurredX), frameGraphExecutor->GetUAV(blurred), smallDesc.Width, smallDesc.Height, false);
+				})
+				.Read(blurredX)
+				.Access(blurred, FrameGraphAccess::UnorderedAccess);
+		}
+		else
+		{
+			frameGraph->AddPass("BlurHorizontal", [=]() { DrawBlur(frameGraphExecutor->GetSRV(source), smallDesc.Width, smallDesc.Height, true); })
+				.Read(source)
+				.Write(blurredX);
+
+			frameGraph->AddPass("BlurVertical", [=]() { DrawBlur(frameGraphExecutor->GetSRV(blurredX), smallDesc.Width, smallDesc.Height, false); })
+				.Read(blurredX)
+				.Write(blurred);
+		}
+
+		// The post pass samples this with a linear filter, so
+		// upsampling it back to full size is free
+		color = blurred;
+		colorUVScale = XMFLOAT2(1, 1);
+	}
+
+	FrameGraphResource tiles = 0;
+	if (motionBlur)
+	{
+		// Find each tile's fastest pixel first, so the blur can
+		// skip the tiles where nothing moved
+		FrameGraphTextureDesc tilesDesc = {
+			(sceneDesc.Width + VelocityTileSize - 1) / VelocityTileSize,
+			(sceneDesc.Height + VelocityTileSize - 1) / VelocityTileSize,
+			DXGI_FORMAT_R16G16_FLOAT };
+		tiles = frameGraph->CreateTexture("VelocityTiles", tilesDesc);
+		frameGraph->AddPass("VelocityTiles", [=]() { DrawVelocityTiles(frameGraphExecutor->GetSRV(depth), renderScale, tilesDesc.Width, tilesDesc.Height); })
+			.Read(depth)
+			.Write(tiles);
+	}
+
+	if (postProcess)
+	{
+		// Every per-pixel effect, in one pass to the back buffer
+		FrameGraphPass& post = frameGraph->AddPass("PostProcess", [=]() {
+			DrawPostProcess(effects, frameGraphExecutor->GetSRV(color), colorUVScale,
+				motionBlur ? frameGraphExecutor->GetSRV(depth) : 0,
+				motionBlur ? frameGraphExecutor->GetSRV(tiles) : 0,
+				renderScale);
+		});
+		post.Read(color);
+		if (motionBlur)
+			post.Read(depth).Read(tiles);
+		post.Write(backBuffer);
+	}
+	else
+	{
+		// Motion blur turns on and off whenever the camera starts or stops,
+		// so keep the scene target around rather than recreating it
+		RenderTargetDesc idleDesc = { sceneDesc.Width, sceneDesc.Height, sceneFormat,
+			D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+		renderTargetPool->Retain(idleDesc);
+	}
+
+	frameGraph->Compile();
+	frameGraphExecutor->Import(backBuffer, backBufferRTV.Get());
+	frameGraphExecutor->Import(depth, 0, depthStencilView.Get(), depthStencilSRV.Get());
+	frameGraphExecutor->Execute(*frameGraph);
+	renderTargetPool->EndFrame();
+
+	// Present the back buffer to the user
+	//  - Puts the final frame we're drawing into the window so the user can see it
+	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
+	swapChain->Present(0, 0);
+
+	// Due to the usage of a more sophisticated swap chain,
+	// the render target must be re-bound after every call to Present()
+	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+}
+
+// --------------------------------------------------------
+// Clears the scene target and depth, then draws the lit
+// entities (render targets are already bound)
+// --------------------------------------------------------
+void Game::DrawScene(ID3D11RenderTargetView* sceneRTV, ID3D11DepthStencilView* sceneDSV, unsigned int renderWidth, unsigned int renderHeight)
 {
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
@@ -501,39 +772,58 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Clear the render target and depth buffer (erases what's on the screen)
 	//  - Do this ONCE PER FRAME
 	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV.Get(), color);
+	context->ClearRenderTargetView(sceneRTV, color);
 	context->ClearDepthStencilView(
-		depthStencilView.Get(),
+		sceneDSV,
 		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
 		1.0f,
 		0);
 
-	context->ClearRenderTargetView(blurRTV.Get(), color);
-
-	// Change the render target
-	//********Post Processing *****************
-	context->OMSetRenderTargets(1, blurRTV.GetAddressOf(), depthStencilView.Get());
+	// Everything after this (particles too) draws at the render size
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)renderWidth;
+	viewport.Height = (float)renderHeight;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+
+	//Bin this frame's point lights, then set lighting
+	std::vector<PointLight> pointLights;
+	pointLights.push_back(point1);
+	for (const LightFlash& flash : lightFlashes)
+	{
+		float fade = 1.0f - flash.Age / flash.Duration;
+		PointLight light = flash.Light;
+		XMStoreFloat3(&light.diffuseColor, XMVectorScale(XMLoadFloat3(&light.diffuseColor), fade));
+		pointLights.push_back(light);
+	}
+	clusteredLighting->Update(context.Get(), pointLights, camera.get(), renderWidth, renderHeight);
 
-	//Set lighting
-	SetGlobalPixelShaderInfo(pixelShader);
-	SetGlobalPixelShaderInfo(pixelShaderNormalMap);
+	for (auto& ps : litPixelShaders->GetLoadedPixelShaders())
+		SetGlobalPixelShaderInfo(ps);
 
-	//Draw the entities
+	//Find what the targets hide
+	occlusionCuller->Begin(camera->GetViewMatrix(), camera->GetProjectionMatrix());
 	for (size_t i = 0; i < targets.size(); i++)
 	{
-		targets[i]->DrawObject(context.Get(), camera.get());
+		occlusionCuller->AddOccluder(targetOccluder, targets[i]->GetTransform()->GetInterpolatedWorldMatrix(GetInterpolation()));
 	}
+	occlusionCuller->Rasterize();
 
-	// check if there are projectiles
-	if (projectiles.size() > 0)
+	//Draw the entities, sorted so they share as much state as possible
+	renderQueue->Begin(camera.get(), GetInterpolation());
+	for (size_t i = 0; i < targets.size(); i++)
 	{
-		for (size_t i = 0; i < projectiles.size(); i++)
-		{
-			projectiles[i]->DrawObject(context.Get(), camera.get());
-		}
+		renderQueue->Submit(targets[i].get());
+	}
+	for (size_t i = 0; i < projectiles.size(); i++)
+	{
+		renderQueue->Submit(projectiles[i].get());
 	}
+	renderQueue->Execute(context.Get());
+}
 
-	//Draw particles
+void Game::DrawParticles()
+{
 	context->OMSetBlendState(particleBlendState.Get(), 0, 0xffffffff);
 	context->OMSetDepthStencilState(particleDepthState.Get(), 0);
 
@@ -547,21 +837,29 @@ void Game::Draw(float deltaTime, float totalTime)
 	//reset
 	context->OMSetBlendState(0, 0, 0xffffffff);
 	context->OMSetDepthStencilState(0, 0);
+}
 
-	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
-
-	//******** Post Processing *****************
+// --------------------------------------------------------
+// Draws a texture through a post processing pixel shader
+// into the bound render target (of the given size), as
+// one big triangle
+// --------------------------------------------------------
+void Game::DrawFullscreen(std::shared_ptr<SimplePixelShader> ps, ID3D11ShaderResourceView* source, unsigned int targetWidth, unsigned int targetHeight)
+{
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)targetWidth;
+	viewport.Height = (float)targetHeight;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
 
 	ppVS->SetShader();
 
-	ppPS->SetShaderResourceView("pixels", ppSRV.Get());
-	ppPS->SetSamplerState("samplerOptions", samplerState.Get());
-	ppPS->SetInt("blurAmount", blurAmount);
-	ppPS->SetShader();
-
-	ppPS->SetFloat("pixelWidth", 1.0f / width);
-	ppPS->SetFloat("pixelHeight", 1.0f / height);
-	ppPS->CopyAllBufferData();
+	if (source)
+		ps->SetShaderResourceView("pixels", source);
+	ps->SetSamplerState("samplerOptions", postSamplerState.Get());
+	ps->SetShader();
+	ps->CopyAllBufferData();
+	ps->FlushResources();
 
 	//// Turn OFF buffers
 	UINT stride = sizeof(Vertex);
@@ -572,20 +870,103 @@ void Game::Draw(float deltaTime, float totalTime)
 
 	// Make big triangle
 	context->Draw(3, 0);
+}
 
-	//Unbind Shader View
-	//******** Post Processing *****************
-	ID3D11ShaderResourceView* nullSRVs[16] = {};
-	context->PSSetShaderResources(0, 16, nullSRVs);
+// --------------------------------------------------------
+// One direction of the separable blur, using blurKernel
+// --------------------------------------------------------
+void Game::DrawBlur(ID3D11ShaderResourceView* source, unsigned int targetWidth, unsigned int targetHeight, bool horizontal)
+{
+	XMFLOAT4 taps[BlurKernel::MaxTaps] = {};
+	const std::vector<BlurTap>& kernelTaps = blurKernel->GetTaps();
+	for (size_t i = 0; i < kernelTaps.size(); i++)
+		taps[i] = XMFLOAT4(kernelTaps[i].Offset, kernelTaps[i].Weight, 0, 0);
 
-	// Present the back buffer to the user
-	//  - Puts the final frame we're drawing into the window so the user can see it
-	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
-	swapChain->Present(0, 0);
+	XMFLOAT2 texelStep = horizontal ? XMFLOAT2(1.0f / targetWidth, 0) : XMFLOAT2(0, 1.0f / targetHeight);
+	blurPS->SetFloat2("texelStep", texelStep);
+	blurPS->SetInt("tapCount", (int)kernelTaps.size());
+	blurPS->SetData("taps", taps, sizeof(taps));
 
-	// Due to the usage of a more sophisticated swap chain,
-	// the render target must be re-bound after every call to Present()
-	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+	DrawFullscreen(blurPS, source, targetWidth, targetHeight);
+}
+
+// --------------------------------------------------------
+// The compute shader version of DrawBlur(): one thread group
+// per 128 texels of a row (or column)
+// --------------------------------------------------------
+void Game::DispatchBlur(ID3D11ShaderResourceView* source, ID3D11UnorderedAccessView* destination, unsigned int targetWidth, unsigned int targetHeight, bool horizontal)
+{
+	XMFLOAT4 weights[BlurKernel::MaxRadius + 1] = {};
+	const std::vector<float>& kernelWeights = blurKernel->GetWeights();
+	for (size_t i = 0; i < kernelWeights.size(); i++)
+		weights[i] = XMFLOAT4(kernelWeights[i], 0, 0, 0);
+
+	blurCS->SetInt("horizontal", horizontal ? 1 : 0);
+	blurCS->SetInt("radius", blurKernel->GetRadius());
+	blurCS->SetData("weights", weights, sizeof(weights));
+	blurCS->SetShaderResourceView("pixels", source);
+	blurCS->SetUnorderedAccessView("output", destination);
+	blurCS->SetShader();
+	blurCS->CopyAllBufferData();
+	blurCS->FlushResources();
+
+	unsigned int lineLength = horizontal ? targetWidth : targetHeight;
+	unsigned int lineCount = horizontal ? targetHeight : targetWidth;
+	blurCS->DispatchByThreads(lineLength, lineCount, 1);
+}
+
+// --------------------------------------------------------
+// Camera reprojection data shared by the motion blur shaders
+// --------------------------------------------------------
+void Game::SetReprojectionData(std::shared_ptr<SimplePixelShader> ps, DirectX::XMFLOAT2 renderScale)
+{
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	XMMATRIX viewProjection = XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection));
+
+	XMFLOAT4X4 inverseViewProjection;
+	XMStoreFloat4x4(&inverseViewProjection, XMMatrixInverse(0, viewProjection));
+
+	ps->SetMatrix4x4("inverseViewProjection", inverseViewProjection);
+	ps->SetMatrix4x4("previousViewProjection", camera->GetPreviousViewProjectionMatrix());
+	ps->SetFloat2("screenSize", XMFLOAT2((float)width, (float)height));
+	ps->SetFloat2("renderScale", renderScale);
+	ps->SetInt("tileSize", VelocityTileSize);
+}
+
+void Game::DrawVelocityTiles(ID3D11ShaderResourceView* depthSRV, DirectX::XMFLOAT2 renderScale, unsigned int tilesWidth, unsigned int tilesHeight)
+{
+	SetReprojectionData(velocityTilesPS, renderScale);
+	velocityTilesPS->SetShaderResourceView("depthBuffer", depthSRV);
+
+	DrawFullscreen(velocityTilesPS, 0, tilesWidth, tilesHeight);
+}
+
+// --------------------------------------------------------
+// The fused post pass: draws (the sourceUVScale part of)
+// source to the back buffer through the uber shader variant
+// for these effects.  The depth and tiles are only used for
+// motion blur
+// --------------------------------------------------------
+void Game::DrawPostProcess(unsigned int effects, ID3D11ShaderResourceView* source, DirectX::XMFLOAT2 sourceUVScale,
+	ID3D11ShaderResourceView* depthSRV, ID3D11ShaderResourceView* tilesSRV, DirectX::XMFLOAT2 renderScale)
+{
+	std::shared_ptr<SimplePixelShader> ps = postStack->GetShader(effects);
+	if (!ps)
+		ps = copyPS;
+
+	ps->SetFloat2("screenSize", XMFLOAT2((float)width, (float)height));
+	ps->SetFloat2("uvScale", sourceUVScale);
+	if (effects & POST_EFFECT_MOTION_BLUR)
+	{
+		SetReprojectionData(ps, renderScale);
+		ps->SetInt("sampleCount", MotionBlurSamples);
+		ps->SetFloat("maxBlurPixels", MaxMotionBlurPixels);
+		ps->SetShaderResourceView("depthBuffer", depthSRV);
+		ps->SetShaderResourceView("velocityTiles", tilesSRV);
+	}
+
+	DrawFullscreen(ps, source, width, height);
 }
 
 //--------------------------------------------
@@ -647,31 +1028,21 @@ std::shared_ptr<Mesh> Game::MakePolygon(int numSides, float centerX, float cente
 }
 
 void Game::SetGlobalPixelShaderInfo(std::shared_ptr<SimplePixelShader> ps) {
-	//Set lighting
-	ps->SetData(
-		"light",
-		&dir1,
-		sizeof(DirectionalLight));
-
-	ps->SetData(
-		"light2",
-		&dir2,
-		sizeof(DirectionalLight));
-
-	ps->SetData(
-		"light3",
-		&dir3,
-		sizeof(DirectionalLight));
-
-	ps->SetData(
-		"light4",
-		&point1,
-		sizeof(PointLight));
-
-	ps->SetData(
-		"cameraPosition",
-		&(camera->GetTransform()->GetPosition()),
-		sizeof(XMFLOAT3));
+	//Set lighting (reflectivity is filled in per material)
+	PixelShaderExternalData psData = {};
+	psData.light = dir1;
+	psData.light2 = dir2;
+	psData.light3 = dir3;
+	psData.cameraPosition = camera->GetTransform()->GetPosition();
+	psData.fogColor = fogColor;
+	psData.fogStart = fogStart;
+	psData.fogEnd = fogEnd;
+	psData.clusterTileScale = clusteredLighting->GetTileScale();
+	psData.clusterSliceScale = clusteredLighting->GetSliceScale();
+	psData.clusterSliceBias = clusteredLighting->GetSliceBias();
+	psData.clusterCounts = clusteredLighting->GetClusterCounts();
+	ps->SetStruct("ExternalData", psData);
+	clusteredLighting->SetShaderResources(ps.get());
 
 	ps->CopyAllBufferData();
 }
@@ -14,6 +14,17 @@
 #include "Projectile.h"
 #include "Emitter.h"
 #include "CollisionManager.h"
+#include "ThreadPool.h"
+#include "AssetLoader.h"
+#include "ShaderPermutations.h"
+#include "RenderQueue.h"
+#include "OcclusionCuller.h"
+#include "ClusteredLighting.h"
+#include "RenderTargetPool.h"
+#include "FrameGraphExecutor.h"
+#include "BlurKernel.h"
+#include "PostProcessStack.h"
+#include "DynamicResolution.h"
 
 class Game 
 	: public DXCore
@@ -28,6 +39,7 @@ public:
 	void Init();
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
+	void UpdateFrame(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
 
@@ -36,12 +48,22 @@ private:
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders(); 
 	void CreateBasicGeometry();
-	void ResizePostProcessResources();
+	void CreateEntities();
 	std::shared_ptr<Mesh> MakeSquare(float centerX, float centerY, float sideSize);
 
 	std::shared_ptr<Mesh> MakePolygon(int numSides, float centerX, float centerY, float radius);
 
 	void SetGlobalPixelShaderInfo(std::shared_ptr<SimplePixelShader> ps);
+	void DrawScene(ID3D11RenderTargetView* sceneRTV, ID3D11DepthStencilView* sceneDSV, unsigned int renderWidth, unsigned int renderHeight);
+	void DrawParticles();
+	void DrawFullscreen(std::shared_ptr<SimplePixelShader> ps, ID3D11ShaderResourceView* source, unsigned int targetWidth, unsigned int targetHeight);
+	void DrawBlur(ID3D11ShaderResourceView* source, unsigned int targetWidth, unsigned int targetHeight, bool horizontal);
+	void DispatchBlur(ID3D11ShaderResourceView* source, ID3D11UnorderedAccessView* destination, unsigned int targetWidth, unsigned int targetHeight, bool horizontal);
+	void SetReprojectionData(std::shared_ptr<SimplePixelShader> ps, DirectX::XMFLOAT2 renderScale);
+	void DrawVelocityTiles(ID3D11ShaderResourceView* depthSRV, DirectX::XMFLOAT2 renderScale, unsigned int tilesWidth, unsigned int tilesHeight);
+	void DrawPostProcess(unsigned int effects, ID3D11ShaderResourceView* source, DirectX::XMFLOAT2 sourceUVScale,
+		ID3D11ShaderResourceView* depthSRV, ID3D11ShaderResourceView* tilesSRV, DirectX::XMFLOAT2 renderScale);
+	void AddLightFlash(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 color, float range, float duration);
 	
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -51,20 +73,20 @@ private:
 	std::vector<std::shared_ptr<Target>> targets;
 	std::vector<std::shared_ptr<Projectile>> projectiles;
 
+	// Background loading (the loader must go before the pool)
+	std::unique_ptr<ThreadPool> threadPool;
+	std::unique_ptr<AssetLoader> assetLoader;
+
 
 	// Shaders and shader-related constructs
-	std::shared_ptr<SimplePixelShader> pixelShader;
-	std::shared_ptr<SimpleVertexShader> vertexShader;
-	std::shared_ptr<SimplePixelShader> pixelShaderNormalMap;
-	std::shared_ptr<SimpleVertexShader> vertexShaderNormalMap;
+	std::shared_ptr<ShaderPermutations> litVertexShaders;	// VertexShader.hlsl variants
+	std::shared_ptr<ShaderPermutations> litPixelShaders;	// PixelShader.hlsl variants
 	std::shared_ptr<SimplePixelShader> particlePS;
 	std::shared_ptr<SimpleVertexShader> particleVS;
 
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> particleDepthState;
 	Microsoft::WRL::ComPtr<ID3D11BlendState> particleBlendState;
 
-	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
-
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> particleTexture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> round_particleTexture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cloverTexture;
@@ -79,9 +101,37 @@ private:
 	DirectionalLight dir3 = {};
 	PointLight point1 = {};
 
+	// Short-lived point lights (muzzle flashes, impacts)
+	struct LightFlash
+	{
+		PointLight Light;
+		float Duration;
+		float Age;
+	};
+	std::vector<LightFlash> lightFlashes;
+
+	// Bins every point light into clusters for the pixel shaders
+	std::unique_ptr<ClusteredLighting> clusteredLighting;
+
+	// Distance fog (for materials with MATERIAL_FEATURE_FOG)
+	DirectX::XMFLOAT3 fogColor;
+	float fogStart;
+	float fogEnd;
+
 	//Camera class
 	std::unique_ptr<Camera> camera;
 
+	// Sorts and draws the frame's entities
+	std::unique_ptr<RenderQueue> renderQueue;
+
+	// Targets hide whatever's behind them, using a box inside
+	// the cylinder as their occluder
+	std::unique_ptr<OcclusionCuller> occlusionCuller;
+	OccluderMesh targetOccluder;
+
+	// Depth pre-pass toggle (P)
+	bool prePassKeyDown;
+
 	// Projectile mesh
 	std::shared_ptr<Mesh> sphereMesh;
 	// Projectile material
@@ -98,13 +148,23 @@ private:
 	float fireRate;
 	float lastShot;
 
-	// blur value
+	// Full screen blur radius (toggled with B), 0 when off
 	int blurAmount;
+	bool blurKeyDown;
+	bool postKeysDown[3];	// T, G, V (see UpdateFrame())
 
 	// Post processing resources
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> blurRTV;		// Allows us to render to a texture
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppSRV;		// Allows us to sample from the same texture
+	std::unique_ptr<RenderTargetPool> renderTargetPool;		// Scene and intermediate targets, recycled each frame
+	std::unique_ptr<FrameGraph> frameGraph;					// Rebuilt every frame in Draw()
+	std::unique_ptr<FrameGraphExecutor> frameGraphExecutor;
+	std::unique_ptr<DynamicResolution> dynamicResolution;	// Scene render scale, from frame times
 	std::shared_ptr<SimpleVertexShader> ppVS;
-	std::shared_ptr<SimplePixelShader> ppPS;
+	std::shared_ptr<SimplePixelShader> copyPS;
+	std::shared_ptr<SimplePixelShader> blurPS;
+	std::shared_ptr<SimpleComputeShader> blurCS;
+	std::shared_ptr<SimplePixelShader> velocityTilesPS;
+	std::unique_ptr<PostProcessStack> postStack;			// Tonemapping, grading, vignette, motion blur
+	std::unique_ptr<BlurKernel> blurKernel;				// Rebuilt when the blur radius changes
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> postSamplerState;	// Linear, clamped
 };
 
@@ -0,0 +1,206 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+LightClusters::LightClusters(ThreadPool* threadPool)
+{
+	this->threadPool = threadPool;
+	sliceScale = 0.0f;
+	sliceBias = 0.0f;
+	clusters.resize(ClusterCount);
+}
+
+void LightClusters::Build(const PointLight* lights, size_t lightCount,
+	XMFLOAT4X4 view, XMFLOAT4X4 projection, float nearClip, float farClip)
+{
+	// Exponential slices: slice boundaries at near * (far / near)^(i / ClustersZ)
+	float logDepthRange = logf(farClip / nearClip);
+	sliceScale = ClustersZ / logDepthRange;
+	sliceBias = -(float)ClustersZ * logf(nearClip) / logDepthRange;
+
+	ComputeBounds(lights, lightCount, view, projection, nearClip, farClip);
+
+	if (threadPool)
+	{
+		threadPool->ParallelFor(ClustersZ, [this](size_t slice) { BinSlice((unsigned int)slice); });
+	}
+	else
+	{
+		for (unsigned int slice = 0; slice < ClustersZ; slice++)
+			BinSlice(slice);
+	}
+
+	// Join the slices' index lists, moving each slice's
+	// offsets to where its list ends up
+	lightIndices.clear();
+	for (unsigned int slice = 0; slice < ClustersZ; slice++)
+	{
+		uint32_t base = (uint32_t)lightIndices.size();
+		LightClusterRange* sliceClusters = &clusters[slice * ClustersX * ClustersY];
+		for (unsigned int i = 0; i < ClustersX * ClustersY; i++)
+			sliceClusters[i].Offset += base;
+
+		lightIndices.insert(lightIndices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+	}
+}
+
+// --------------------------------------------------------
+// Finds the clusters each light's sphere could touch, four
+// lights at a time.  The screen rectangle comes from
+// projecting the corners of the sphere's view space box,
+// which is conservative; a sphere reaching in front of the
+// near plane covers the whole screen
+// --------------------------------------------------------
+void LightClusters::ComputeBounds(const PointLight* lights, size_t lightCount,
+	XMFLOAT4X4 view, XMFLOAT4X4 projection, float nearClip, float farClip)
+{
+	bounds.resize(lightCount);
+
+	XMVECTOR nearPlane = XMVectorReplicate(nearClip);
+	XMVECTOR one = XMVectorReplicate(1.0f);
+	XMVECTOR scaleX = XMVectorReplicate(projection._11);
+	XMVECTOR scaleY = XMVectorReplicate(projection._22);
+
+	for (size_t i = 0; i < lightCount; i += 4)
+	{
+		size_t lanes = lightCount - i < 4 ? lightCount - i : 4;
+
+		// Gather into SoA (a short batch repeats its first light)
+		XMFLOAT4 px, py, pz, pr;
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			const PointLight& light = lights[i + (lane < lanes ? lane : 0)];
+			(&px.x)[lane] = light.position.x;
+			(&py.x)[lane] = light.position.y;
+			(&pz.x)[lane] = light.position.z;
+			(&pr.x)[lane] = light.range;
+		}
+		XMVECTOR x = XMLoadFloat4(&px);
+		XMVECTOR y = XMLoadFloat4(&py);
+		XMVECTOR z = XMLoadFloat4(&pz);
+		XMVECTOR r = XMLoadFloat4(&pr);
+
+		// To view space (row vectors: v * view)
+		XMVECTOR vx = XMVectorMultiplyAdd(x, XMVectorReplicate(view._11), XMVectorMultiplyAdd(y, XMVectorReplicate(view._21), XMVectorMultiplyAdd(z, XMVectorReplicate(view._31), XMVectorReplicate(view._41))));
+		XMVECTOR vy = XMVectorMultiplyAdd(x, XMVectorReplicate(view._12), XMVectorMultiplyAdd(y, XMVectorReplicate(view._22), XMVectorMultiplyAdd(z, XMVectorReplicate(view._32), XMVectorReplicate(view._42))));
+		XMVECTOR vz = XMVectorMultiplyAdd(x, XMVectorReplicate(view._13), XMVectorMultiplyAdd(y, XMVectorReplicate(view._23), XMVectorMultiplyAdd(z, XMVectorReplicate(view._33), XMVectorReplicate(view._43))));
+
+		XMVECTOR zNear = XMVectorSubtract(vz, r);
+		XMVECTOR zFar = XMVectorAdd(vz, r);
+		XMVECTOR crossesNear = XMVectorLess(zNear, nearPlane);
+
+		// NDC x and y at the box's four corner combinations of
+		// (min/max side, near/far depth).  Lanes crossing the
+		// near plane get junk here and are replaced below
+		XMVECTOR invNear = XMVectorReciprocal(XMVectorMax(zNear, nearPlane));
+		XMVECTOR invFar = XMVectorReciprocal(XMVectorMax(zFar, nearPlane));
+		XMVECTOR left = XMVectorMultiply(XMVectorSubtract(vx, r), scaleX);
+		XMVECTOR right = XMVectorMultiply(XMVectorAdd(vx, r), scaleX);
+		XMVECTOR bottom = XMVectorMultiply(XMVectorSubtract(vy, r), scaleY);
+		XMVECTOR top = XMVectorMultiply(XMVectorAdd(vy, r), scaleY);
+
+		XMVECTOR minX = XMVectorMin(XMVectorMultiply(left, invNear), XMVectorMultiply(left, invFar));
+		XMVECTOR maxX = XMVectorMax(XMVectorMultiply(right, invNear), XMVectorMultiply(right, invFar));
+		XMVECTOR minY = XMVectorMin(XMVectorMultiply(bottom, invNear), XMVectorMultiply(bottom, invFar));
+		XMVECTOR maxY = XMVectorMax(XMVectorMultiply(top, invNear), XMVectorMultiply(top, invFar));
+
+		XMVECTOR negOne = XMVectorNegate(one);
+		minX = XMVectorSelect(minX, negOne, crossesNear);
+		minY = XMVectorSelect(minY, negOne, crossesNear);
+		maxX = XMVectorSelect(maxX, one, crossesNear);
+		maxY = XMVectorSelect(maxY, one, crossesNear);
+
+		XMFLOAT4 outMinX, outMaxX, outMinY, outMaxY, outNear, outFar;
+		XMStoreFloat4(&outMinX, minX);
+		XMStoreFloat4(&outMaxX, maxX);
+		XMStoreFloat4(&outMinY, minY);
+		XMStoreFloat4(&outMaxY, maxY);
+		XMStoreFloat4(&outNear, zNear);
+		XMStoreFloat4(&outFar, zFar);
+
+		for (size_t lane = 0; lane < lanes; lane++)
+		{
+			LightBounds& b = bounds[i + lane];
+			float lightNear = (&outNear.x)[lane];
+			float lightFar = (&outFar.x)[lane];
+
+			// Entirely in front of or behind the view
+			if (lightFar < nearClip || lightNear > farClip)
+			{
+				b.MinX = b.MinY = b.MinZ = 1;
+				b.MaxX = b.MaxY = b.MaxZ = 0;
+				continue;
+			}
+
+			// NDC to tiles (y flips, as tiles go down the screen)
+			b.MinX = (int)floorf(((&outMinX.x)[lane] * 0.5f + 0.5f) * ClustersX);
+			b.MaxX = (int)floorf(((&outMaxX.x)[lane] * 0.5f + 0.5f) * ClustersX);
+			b.MinY = (int)floorf((0.5f - (&outMaxY.x)[lane] * 0.5f) * ClustersY);
+			b.MaxY = (int)floorf((0.5f - (&outMinY.x)[lane] * 0.5f) * ClustersY);
+			b.MinX = (std::max)(b.MinX, 0);
+			b.MinY = (std::max)(b.MinY, 0);
+			b.MaxX = (std::min)(b.MaxX, (int)ClustersX - 1);
+			b.MaxY = (std::min)(b.MaxY, (int)ClustersY - 1);
+
+			b.MinZ = (int)floorf(logf((std::max)(lightNear, nearClip)) * sliceScale + sliceBias);
+			b.MaxZ = (int)floorf(logf((std::min)(lightFar, farClip)) * sliceScale + sliceBias);
+			b.MinZ = (std::max)(b.MinZ, 0);
+			b.MaxZ = (std::min)(b.MaxZ, (int)ClustersZ - 1);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Builds one slice's index lists: count the lights per
+// cluster, turn the counts into offsets, then fill them in.
+// Slices don't share any output, so they can run at once
+// --------------------------------------------------------
+void LightClusters::BinSlice(unsigned int slice)
+{
+	const unsigned int tileCount = ClustersX * ClustersY;
+	LightClusterRange* sliceClusters = &clusters[slice * tileCount];
+	for (unsigned int i = 0; i < tileCount; i++)
+	{
+		sliceClusters[i].Offset = 0;
+		sliceClusters[i].Count = 0;
+	}
+
+	for (const LightBounds& b : bounds)
+	{
+		if ((int)slice < b.MinZ || (int)slice > b.MaxZ)
+			continue;
+
+		for (int y = b.MinY; y <= b.MaxY; y++)
+			for (int x = b.MinX; x <= b.MaxX; x++)
+				sliceClusters[y * ClustersX + x].Count++;
+	}
+
+	uint32_t total = 0;
+	for (unsigned int i = 0; i < tileCount; i++)
+	{
+		sliceClusters[i].Offset = total;
+		total += sliceClusters[i].Count;
+		sliceClusters[i].Count = 0;
+	}
+
+	std::vector<uint32_t>& indices = sliceIndices[slice];
+	indices.resize(total);
+	for (uint32_t light = 0; light < (uint32_t)bounds.size(); light++)
+	{
+		const LightBounds& b = bounds[light];
+		if ((int)slice < b.MinZ || (int)slice > b.MaxZ)
+			continue;
+
+		for (int y = b.MinY; y <= b.MaxY; y++)
+		{
+			for (int x = b.MinX; x <= b.MaxX; x++)
+			{
+				LightClusterRange& cluster = sliceClusters[y * ClustersX + x];
+				indices[cluster.Offset + cluster.Count++] = light;
+			}
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+#include "Lights.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// One cluster's slice of the light index list (a uint2 in
+// the shaders)
+// --------------------------------------------------------
+struct LightClusterRange
+{
+	uint32_t Offset;
+	uint32_t Count;
+};
+
+// --------------------------------------------------------
+// Bins point lights into view space clusters ("froxels"):
+// the screen split into a grid of tiles, each split again
+// into depth slices that get exponentially thicker with
+// distance.  Every cluster gets the list of lights whose
+// range might reach it, so a pixel only evaluates those.
+//
+// Clusters are indexed (slice * ClustersY + y) * ClustersX + x,
+// with y going down the screen.  Slice = floor(log(viewZ) *
+// GetSliceScale() + GetSliceBias()).
+//
+// Lights are set up four at a time and the slices are
+// binned in parallel.  Nothing here touches D3D.
+// --------------------------------------------------------
+class LightClusters
+{
+public:
+	static const unsigned int ClustersX = 16;
+	static const unsigned int ClustersY = 8;
+	static const unsigned int ClustersZ = 24;
+	static const unsigned int ClusterCount = ClustersX * ClustersY * ClustersZ;
+
+	// With no thread pool, slices are binned on the calling thread
+	LightClusters(ThreadPool* threadPool);
+
+	void Build(const PointLight* lights, size_t lightCount,
+		DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection,
+		float nearClip, float farClip);
+
+	const std::vector<LightClusterRange>& GetClusters() { return clusters; }
+	const std::vector<uint32_t>& GetLightIndices() { return lightIndices; }
+	float GetSliceScale() { return sliceScale; }
+	float GetSliceBias() { return sliceBias; }
+
+private:
+	ThreadPool* threadPool;
+	float sliceScale;
+	float sliceBias;
+
+	// Each light's cluster bounds (inclusive), or an empty
+	// range (min > max) if it can't reach the view
+	struct LightBounds
+	{
+		int MinX, MaxX;
+		int MinY, MaxY;
+		int MinZ, MaxZ;
+	};
+	std::vector<LightBounds> bounds;
+
+	// Per slice results, joined into the final lists at the end
+	std::vector<uint32_t> sliceIndices[ClustersZ];
+
+	std::vector<LightClusterRange> clusters;
+	std::vector<uint32_t> lightIndices;
+
+	void ComputeBounds(const PointLight* lights, size_t lightCount,
+		DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection,
+		float nearClip, float farClip);
+	void BinSlice(unsigned int slice);
+};
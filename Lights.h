@@ -16,5 +16,5 @@ struct PointLight {
 	DirectX::XMFLOAT3 diffuseColor;
 	float padding2;
 	DirectX::XMFLOAT3 position;
-	float padding3;
+	float range; // Fades to nothing at this distance
 };
\ No newline at end of file
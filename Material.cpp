@@ -1,19 +1,24 @@
 #include "Material.h"
 
+unsigned int Material::nextId = 0;
+
 Material::Material(DirectX::XMFLOAT4 tint, float reflect, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResource,
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sState, std::shared_ptr<SimpleVertexShader> vShader,
 	std::shared_ptr<SimplePixelShader> pShader)
 {
+	id = nextId++;
 	colorTint = tint;
 	samplerState = sState;
 	shaderResourceView = shaderResource;
 	reflectivity = reflect;
 	pixelShader = pShader;
 	vertexShader = vShader;
+	shaderFeatures = 0;
 }
 
 Material::Material(DirectX::XMFLOAT4 tint, float reflect, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResource, Microsoft::WRL::ComPtr<ID3D11SamplerState> sState, std::shared_ptr<SimpleVertexShader> vShader, std::shared_ptr<SimplePixelShader> pShader, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> nMap)
 {
+	id = nextId++;
 	colorTint = tint;
 	samplerState = sState;
 	shaderResourceView = shaderResource;
@@ -21,6 +26,23 @@ Material::Material(DirectX::XMFLOAT4 tint, float reflect, Microsoft::WRL::ComPtr
 	pixelShader = pShader;
 	vertexShader = vShader;
 	normalMap = nMap;
+	shaderFeatures = nMap ? MATERIAL_FEATURE_NORMAL_MAP : 0;
+}
+
+Material::Material(DirectX::XMFLOAT4 tint, float reflect, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResource, Microsoft::WRL::ComPtr<ID3D11SamplerState> sState, std::shared_ptr<ShaderPermutations> vPermutations, std::shared_ptr<ShaderPermutations> pPermutations, unsigned int features, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> nMap)
+{
+	id = nextId++;
+	colorTint = tint;
+	samplerState = sState;
+	shaderResourceView = shaderResource;
+	reflectivity = reflect;
+	normalMap = nMap;
+	vertexPermutations = vPermutations;
+	pixelPermutations = pPermutations;
+
+	if (nMap)
+		features |= MATERIAL_FEATURE_NORMAL_MAP;
+	SetShaderFeatures(features);
 }
 
 DirectX::XMFLOAT4 Material::GetColorTint() const
@@ -38,6 +60,11 @@ std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() const
 	return vertexShader;
 }
 
+std::shared_ptr<SimpleVertexShader> Material::GetInstancedVertexShader() const
+{
+	return instancedVertexShader;
+}
+
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Material::GetShaderResource() const
 {
 	return shaderResourceView;
@@ -63,6 +90,16 @@ float Material::GetReflectivity() const
 	return reflectivity;
 }
 
+unsigned int Material::GetShaderFeatures() const
+{
+	return shaderFeatures;
+}
+
+unsigned int Material::GetId() const
+{
+	return id;
+}
+
 void Material::SetColorTint(DirectX::XMFLOAT4 tint)
 {
 	colorTint = tint;
@@ -72,3 +109,23 @@ void Material::SetReflectivity(float newReflect)
 {
 	reflectivity = newReflect;
 }
+
+// Swaps to the shader variants for the new features (loading
+// them if this is the first material to need them)
+void Material::SetShaderFeatures(unsigned int features)
+{
+	shaderFeatures = features;
+
+	if (vertexPermutations)
+	{
+		vertexShader = vertexPermutations->GetVertexShader(features);
+
+		// The renderer draws with this variant when batching
+		// several entities that use this material
+		instancedVertexShader = vertexPermutations->GetVertexShader(features | MATERIAL_FEATURE_INSTANCED);
+		if (instancedVertexShader && !instancedVertexShader->GetPerInstanceCompatible())
+			instancedVertexShader = nullptr;
+	}
+	if (pixelPermutations)
+		pixelShader = pixelPermutations->GetPixelShader(features);
+}
@@ -3,8 +3,16 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include "SimpleShader.h"
+#include "ShaderPermutations.h"
 #include <memory>
 
+// Shader features a material can ask for.  Each maps to a define
+// in VertexShader.hlsl / PixelShader.hlsl (see Game::LoadShaders)
+#define MATERIAL_FEATURE_NORMAL_MAP			0x1
+#define MATERIAL_FEATURE_POINT_LIGHTS		0x2 // Clustered point lights (see ClusteredLighting)
+#define MATERIAL_FEATURE_FOG				0x8
+#define MATERIAL_FEATURE_INSTANCED			0x10 // Set by the renderer, not materials
+
 class Material
 {
 public:
@@ -14,17 +22,30 @@ public:
 	Material(DirectX::XMFLOAT4 tint, float reflect, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResource,
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> sState, std::shared_ptr<SimpleVertexShader> vShader,
 		std::shared_ptr<SimplePixelShader> pShader, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> nMap);
+	// Picks its shaders out of permutation sets by feature mask
+	// (the normal map feature is added automatically if nMap is set)
+	Material(DirectX::XMFLOAT4 tint, float reflect, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResource,
+		Microsoft::WRL::ComPtr<ID3D11SamplerState> sState, std::shared_ptr<ShaderPermutations> vPermutations,
+		std::shared_ptr<ShaderPermutations> pPermutations, unsigned int features,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> nMap = nullptr);
 	DirectX::XMFLOAT4 GetColorTint() const;
 	std::shared_ptr<SimplePixelShader> GetPixelShader() const;
 	std::shared_ptr<SimpleVertexShader> GetVertexShader() const;
+	std::shared_ptr<SimpleVertexShader> GetInstancedVertexShader() const; // Null if there's no instanced variant
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetShaderResource() const;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetNormalMap() const;
 	bool IsNormalMap() const;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSamplerState() const;
 	float GetReflectivity() const;
+	unsigned int GetShaderFeatures() const;
+	unsigned int GetId() const; // Unique per material, for sorting draws
 	void SetColorTint(DirectX::XMFLOAT4 tint);
 	void SetReflectivity(float newReflect);
+	void SetShaderFeatures(unsigned int features);
 private:
+	static unsigned int nextId;
+	unsigned int id;
+
 	DirectX::XMFLOAT4 colorTint;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalMap;
@@ -32,5 +53,11 @@ private:
 	float reflectivity;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+
+	// Only set when using shader permutations
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader;
+	std::shared_ptr<ShaderPermutations> vertexPermutations;
+	std::shared_ptr<ShaderPermutations> pixelPermutations;
+	unsigned int shaderFeatures;
 };
 
@@ -1,26 +1,44 @@
 #include "Mesh.h"
 
+unsigned int Mesh::nextId = 0;
+
 Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
+	id = nextId++;
 	CreateBuffers(vertices, vertexCount, indices, indexCount, device);
 }
 
 Mesh::Mesh(const char* fileName, Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	id = nextId++;
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!LoadOBJ(fileName, verts, indices))
+		return;
+
+	CreateBuffers(verts.data(), (int)verts.size(), indices.data(), (int)indices.size(), device);
+}
+
+// Parses an OBJ file into vertex and index data without touching
+// the device, so it can run on a worker thread.  Tangents and the
+// collider are still calculated when the buffers are created
+bool Mesh::LoadOBJ(const char* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
 {
 	// File input object
 	std::ifstream obj(fileName);
 
 	// Check for successful open
 	if (!obj.is_open())
-		return;
+		return false;
 
 	// Variables used while reading the file
 	std::vector<DirectX::XMFLOAT3> positions;     // Positions from the file
 	std::vector<DirectX::XMFLOAT3> normals;       // Normals from the file
 	std::vector<DirectX::XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
 	unsigned int vertCounter = 0;        // Count of vertices/indices
+	verts.clear();
+	indices.clear();
 	char chars[100];                     // String for line reading
 
 	// Still have data left?
@@ -164,7 +182,7 @@ Mesh::Mesh(const char* fileName, Microsoft::WRL::ComPtr<ID3D11Device> device)
 		}
 	}
 
-	// Close the file and create the actual buffers
+	// Close the file
 	obj.close();
 
 
@@ -178,7 +196,7 @@ Mesh::Mesh(const char* fileName, Microsoft::WRL::ComPtr<ID3D11Device> device)
 	// - Yes, the indices are a bit redundant here (one per vertex).  Could you skip using
 	//    an index buffer in this case?  Sure!  Though, if your mesh class assumes you have
 	//    one, you'll need to write some extra code to handle cases when you don't.
-	CreateBuffers(verts.data(), verts.size(), indices.data(), indices.size(), device);
+	return !verts.empty();
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
@@ -329,8 +347,8 @@ void Mesh::CalculateCollider(Vertex* verts, int numVerts)
 	float maxX = verts[0].Position.x;
 	float minY = verts[0].Position.y;
 	float maxY = verts[0].Position.y;
-	float minZ = verts[0].Position.y;
-	float maxZ = verts[0].Position.y;
+	float minZ = verts[0].Position.z;
+	float maxZ = verts[0].Position.z;
 
 	for (int i = 1; i < numVerts; i++)
 	{
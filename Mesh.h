@@ -20,6 +20,8 @@ public:
 		Microsoft::WRL::ComPtr<ID3D11Device> device);
 	Mesh(const char* fileName, Microsoft::WRL::ComPtr<ID3D11Device> device);
 
+	static bool LoadOBJ(const char* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 
@@ -28,7 +30,13 @@ public:
 	Collider* GetCollider();
 
 	int GetIndexCount();
+
+	// Unique per mesh, for sorting draws (see RenderQueue)
+	unsigned int GetId() const { return id; }
 private:
+	static unsigned int nextId;
+	unsigned int id;
+
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	std::unique_ptr<Collider> collider;
@@ -0,0 +1,302 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+OccluderMesh OccluderMesh::MakeBox(XMFLOAT3 min, XMFLOAT3 max)
+{
+	OccluderMesh box;
+	for (int i = 0; i < 8; i++)
+	{
+		box.Vertices.push_back(XMFLOAT3(
+			(i & 1) ? max.x : min.x,
+			(i & 2) ? max.y : min.y,
+			(i & 4) ? max.z : min.z));
+	}
+
+	// Two triangles per face (winding doesn't matter, as
+	// both sides are rasterized)
+	unsigned int faces[] =
+	{
+		0, 1, 3, 0, 3, 2,	// -Z
+		4, 6, 7, 4, 7, 5,	// +Z
+		0, 2, 6, 0, 6, 4,	// -X
+		1, 5, 7, 1, 7, 3,	// +X
+		0, 4, 5, 0, 5, 1,	// -Y
+		2, 3, 7, 2, 7, 6,	// +Y
+	};
+	box.Indices.assign(faces, faces + sizeof(faces) / sizeof(faces[0]));
+	return box;
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height, ThreadPool* threadPool)
+{
+	tilesX = (width + TileWidth - 1) / TileWidth;
+	tilesY = (height + TileHeight - 1) / TileHeight;
+	this->width = tilesX * TileWidth;
+	this->height = tilesY * TileHeight;
+	this->threadPool = threadPool;
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	depth.resize(this->width * this->height, 1.0f);
+	tileMaxDepth.resize(tilesX * tilesY, 1.0f);
+	tileTriangles.resize(tilesX * tilesY);
+}
+
+void OcclusionCuller::Begin(XMFLOAT4X4 view, XMFLOAT4X4 projection)
+{
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+	triangles.clear();
+	for (auto& bin : tileTriangles)
+		bin.clear();
+}
+
+// --------------------------------------------------------
+// Projects the occluder's triangles to the screen.  Any
+// triangle crossing the near plane is dropped rather than
+// clipped - leaving out an occluder is always safe
+// --------------------------------------------------------
+void OcclusionCuller::AddOccluder(const OccluderMesh& mesh, XMFLOAT4X4 world)
+{
+	XMMATRIX worldViewProjection = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&viewProjection));
+
+	std::vector<XMFLOAT4> clip(mesh.Vertices.size());
+	for (size_t i = 0; i < mesh.Vertices.size(); i++)
+		XMStoreFloat4(&clip[i], XMVector3Transform(XMLoadFloat3(&mesh.Vertices[i]), worldViewProjection));
+
+	for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+	{
+		ScreenTriangle tri;
+		bool behind = false;
+		for (int v = 0; v < 3; v++)
+		{
+			XMFLOAT4 c = clip[mesh.Indices[i + v]];
+			if (c.w <= 1e-5f || c.z < 0.0f)
+			{
+				behind = true;
+				break;
+			}
+
+			tri.X[v] = (c.x / c.w * 0.5f + 0.5f) * width;
+			tri.Y[v] = (0.5f - c.y / c.w * 0.5f) * height;
+			tri.Z[v] = c.z / c.w;
+		}
+		if (behind)
+			continue;
+
+		// Pixels whose centers could be inside
+		float minX = (std::min)((std::min)(tri.X[0], tri.X[1]), tri.X[2]);
+		float maxX = (std::max)((std::max)(tri.X[0], tri.X[1]), tri.X[2]);
+		float minY = (std::min)((std::min)(tri.Y[0], tri.Y[1]), tri.Y[2]);
+		float maxY = (std::max)((std::max)(tri.Y[0], tri.Y[1]), tri.Y[2]);
+		tri.MinX = (std::max)((int)ceilf(minX - 0.5f), 0);
+		tri.MinY = (std::max)((int)ceilf(minY - 0.5f), 0);
+		tri.MaxX = (std::min)((int)floorf(maxX - 0.5f), (int)width - 1);
+		tri.MaxY = (std::min)((int)floorf(maxY - 0.5f), (int)height - 1);
+		if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+			continue;
+
+		// Wind every triangle the same way, so the edge
+		// functions are positive inside
+		float area = (tri.X[1] - tri.X[0]) * (tri.Y[2] - tri.Y[0]) - (tri.Y[1] - tri.Y[0]) * (tri.X[2] - tri.X[0]);
+		if (fabsf(area) < 1e-6f)
+			continue;
+		if (area < 0.0f)
+		{
+			std::swap(tri.X[1], tri.X[2]);
+			std::swap(tri.Y[1], tri.Y[2]);
+			std::swap(tri.Z[1], tri.Z[2]);
+		}
+
+		triangles.push_back(tri);
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	// Bin each triangle into the tiles its bounds touch
+	for (uint32_t i = 0; i < (uint32_t)triangles.size(); i++)
+	{
+		const ScreenTriangle& tri = triangles[i];
+		for (int ty = tri.MinY / (int)TileHeight; ty <= tri.MaxY / (int)TileHeight; ty++)
+			for (int tx = tri.MinX / (int)TileWidth; tx <= tri.MaxX / (int)TileWidth; tx++)
+				tileTriangles[ty * tilesX + tx].push_back(i);
+	}
+
+	// Tiles don't share pixels, so they can all go at once
+	size_t tileCount = tileTriangles.size();
+	if (threadPool)
+	{
+		threadPool->ParallelFor(tileCount, [this](size_t tile) { RasterizeTile((unsigned int)tile); });
+	}
+	else
+	{
+		for (size_t tile = 0; tile < tileCount; tile++)
+			RasterizeTile((unsigned int)tile);
+	}
+}
+
+// --------------------------------------------------------
+// Clears one tile and rasterizes its triangles, keeping the
+// nearest depth, four pixels per step.  Afterwards the
+// tile's farthest depth is stored for the coarse test
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+	int tileX = (int)((tile % tilesX) * TileWidth);
+	int tileY = (int)((tile / tilesX) * TileHeight);
+
+	for (unsigned int y = 0; y < TileHeight; y++)
+		std::fill_n(&depth[(tileY + y) * width + tileX], TileWidth, 1.0f);
+
+	XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	XMVECTOR zero = XMVectorZero();
+
+	for (uint32_t index : tileTriangles[tile])
+	{
+		const ScreenTriangle& tri = triangles[index];
+
+		// Edge function i is zero along the edge opposite vertex i:
+		// e = a * x + b * y + c
+		float a[3], b[3], c[3];
+		for (int e = 0; e < 3; e++)
+		{
+			int v0 = (e + 1) % 3;
+			int v1 = (e + 2) % 3;
+			a[e] = tri.Y[v0] - tri.Y[v1];
+			b[e] = tri.X[v1] - tri.X[v0];
+			c[e] = tri.X[v0] * tri.Y[v1] - tri.Y[v0] * tri.X[v1];
+		}
+
+		// Depth from the (unnormalized) barycentrics
+		float area = c[0] + a[0] * tri.X[0] + b[0] * tri.Y[0];
+		XMVECTOR z0 = XMVectorReplicate(tri.Z[0]);
+		XMVECTOR dz1 = XMVectorReplicate((tri.Z[1] - tri.Z[0]) / area);
+		XMVECTOR dz2 = XMVectorReplicate((tri.Z[2] - tri.Z[0]) / area);
+
+		int minX = (std::max)(tri.MinX, tileX) & ~3;
+		int maxX = (std::min)(tri.MaxX, tileX + (int)TileWidth - 1);
+		int minY = (std::max)(tri.MinY, tileY);
+		int maxY = (std::min)(tri.MaxY, tileY + (int)TileHeight - 1);
+
+		XMVECTOR a0 = XMVectorReplicate(a[0]), a1 = XMVectorReplicate(a[1]), a2 = XMVectorReplicate(a[2]);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			XMVECTOR row0 = XMVectorReplicate(b[0] * py + c[0]);
+			XMVECTOR row1 = XMVectorReplicate(b[1] * py + c[1]);
+			XMVECTOR row2 = XMVectorReplicate(b[2] * py + c[2]);
+
+			float* pixels = &depth[y * width];
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+				XMVECTOR e0 = XMVectorMultiplyAdd(a0, px, row0);
+				XMVECTOR e1 = XMVectorMultiplyAdd(a1, px, row1);
+				XMVECTOR e2 = XMVectorMultiplyAdd(a2, px, row2);
+
+				XMVECTOR inside = XMVectorAndInt(XMVectorGreaterOrEqual(e0, zero),
+					XMVectorAndInt(XMVectorGreaterOrEqual(e1, zero), XMVectorGreaterOrEqual(e2, zero)));
+
+				XMVECTOR z = XMVectorMultiplyAdd(e1, dz1, XMVectorMultiplyAdd(e2, dz2, z0));
+				XMVECTOR current = XMLoadFloat4((const XMFLOAT4*)&pixels[x]);
+				XMVECTOR nearer = XMVectorAndInt(inside, XMVectorLess(z, current));
+				XMStoreFloat4((XMFLOAT4*)&pixels[x], XMVectorSelect(current, z, nearer));
+			}
+		}
+	}
+
+	float farthest = 0.0f;
+	for (unsigned int y = 0; y < TileHeight; y++)
+	{
+		const float* row = &depth[(tileY + y) * width + tileX];
+		for (unsigned int x = 0; x < TileWidth; x++)
+			farthest = (std::max)(farthest, row[x]);
+	}
+	tileMaxDepth[tile] = farthest;
+}
+
+void OcclusionCuller::TestBoxes(const BoundsSoA& bounds, size_t count, uint8_t* visible) const
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!visible[i])
+			continue;
+
+		XMFLOAT3 center(bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i]);
+		XMFLOAT3 extents(bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i]);
+		if (!IsBoxVisible(center, extents))
+			visible[i] = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Finds the box's screen rectangle and nearest depth, then
+// looks for any pixel in the rectangle where the occluders
+// are at or behind that depth.  Whole tiles whose farthest
+// occluder is in front of the box are skipped
+// --------------------------------------------------------
+bool OcclusionCuller::IsBoxVisible(XMFLOAT3 center, XMFLOAT3 extents) const
+{
+	XMMATRIX m = XMLoadFloat4x4(&viewProjection);
+	float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f;
+	float minZ = 1.0f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		XMFLOAT3 corner(
+			center.x + ((i & 1) ? extents.x : -extents.x),
+			center.y + ((i & 2) ? extents.y : -extents.y),
+			center.z + ((i & 4) ? extents.z : -extents.z));
+
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, XMVector3Transform(XMLoadFloat3(&corner), m));
+
+		// Reaches behind the near plane, so it can't be hidden
+		if (c.w <= 1e-5f || c.z < 0.0f)
+			return true;
+
+		minX = (std::min)(minX, c.x / c.w);
+		maxX = (std::max)(maxX, c.x / c.w);
+		minY = (std::min)(minY, c.y / c.w);
+		maxY = (std::max)(maxY, c.y / c.w);
+		minZ = (std::min)(minZ, c.z / c.w);
+	}
+
+	// Every pixel the rectangle touches (y flips to go down the screen)
+	int left = (std::max)((int)floorf((minX * 0.5f + 0.5f) * width), 0);
+	int right = (std::min)((int)floorf((maxX * 0.5f + 0.5f) * width), (int)width - 1);
+	int top = (std::max)((int)floorf((0.5f - maxY * 0.5f) * height), 0);
+	int bottom = (std::min)((int)floorf((0.5f - minY * 0.5f) * height), (int)height - 1);
+	if (left > right || top > bottom)
+		return true; // Off screen - leave that to frustum culling
+
+	for (int ty = top / (int)TileHeight; ty <= bottom / (int)TileHeight; ty++)
+	{
+		for (int tx = left / (int)TileWidth; tx <= right / (int)TileWidth; tx++)
+		{
+			if (minZ > tileMaxDepth[ty * tilesX + tx])
+				continue;
+
+			int x0 = (std::max)(left, tx * (int)TileWidth);
+			int x1 = (std::min)(right, (tx + 1) * (int)TileWidth - 1);
+			int y0 = (std::max)(top, ty * (int)TileHeight);
+			int y1 = (std::min)(bottom, (ty + 1) * (int)TileHeight - 1);
+			for (int y = y0; y <= y1; y++)
+			{
+				const float* row = &depth[y * width];
+				for (int x = x0; x <= x1; x++)
+				{
+					if (row[x] >= minZ)
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
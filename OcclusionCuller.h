@@ -0,0 +1,88 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// A low-poly stand-in for an occluder.  It has to fit
+// entirely inside the real object, or it'll hide things
+// that should be visible around the object's edges.
+// --------------------------------------------------------
+struct OccluderMesh
+{
+	std::vector<DirectX::XMFLOAT3> Vertices;
+	std::vector<unsigned int> Indices;
+
+	static OccluderMesh MakeBox(DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+};
+
+// --------------------------------------------------------
+// Software occlusion culling.  Each frame a few large
+// occluders are rasterized into a small CPU depth buffer,
+// then bounding boxes are tested against it: a box whose
+// nearest point is behind the occluders everywhere it
+// covers is hidden.
+//
+// The buffer is split into tiles, each rasterized by one
+// thread (four pixels at a time), and keeps the farthest
+// depth per tile so most boxes are decided without looking
+// at individual pixels.
+//
+// Nothing here touches D3D, so it can run headless.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	static const unsigned int TileWidth = 32;
+	static const unsigned int TileHeight = 16;
+
+	// Width and height are rounded up to whole tiles.  With no
+	// thread pool the tiles are rasterized on the calling thread
+	OcclusionCuller(unsigned int width, unsigned int height, ThreadPool* threadPool);
+
+	// Clears the depth buffer and occluders for a new camera
+	void Begin(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection);
+
+	void AddOccluder(const OccluderMesh& mesh, DirectX::XMFLOAT4X4 world);
+
+	// Rasterizes everything added since Begin()
+	void Rasterize();
+
+	// Clears visible[i] for each box that's hidden (boxes
+	// that are already not visible are skipped)
+	void TestBoxes(const BoundsSoA& bounds, size_t count, uint8_t* visible) const;
+
+	unsigned int GetWidth() { return width; }
+	unsigned int GetHeight() { return height; }
+	const float* GetDepth() { return depth.data(); }
+	size_t GetTriangleCount() { return triangles.size(); }
+
+private:
+	// Screen space (pixels, y down) with depth in [0, 1]
+	struct ScreenTriangle
+	{
+		float X[3];
+		float Y[3];
+		float Z[3];
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+	ThreadPool* threadPool;
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<uint32_t>> tileTriangles;
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+
+	void RasterizeTile(unsigned int tile);
+	bool IsBoxVisible(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents) const;
+};
@@ -1,16 +1,52 @@
-#include<ShaderEverything.hlsli>
+#include "ShaderEverything.hlsli"
 
+// Feature defines, set per variant by ShaderPermutations
+// (see Game::LoadShaders).  Off when built by the project.
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS 0
+#endif
+#ifndef FOG
+#define FOG 0
+#endif
+
+#if NORMAL_MAP
+#define PIXEL_INPUT VertexToPixelNormalMap
+#else
+#define PIXEL_INPUT VertexToPixel
+#endif
+
+// The layout is the same for every variant, so one
+// C++ struct (PixelShaderExternalData) fills them all
 cbuffer ExternalData : register(b0)
 {
 	DirectionalLight light;
 	DirectionalLight light2;
 	DirectionalLight light3;
-	PointLight light4;
 	float reflectivity;
 	float3 cameraPosition;
+	float3 fogColor;
+	float fogStart;
+	float fogEnd;
+
+	// Light cluster lookup (see ClusteredLighting)
+	float2 clusterTileScale;	// Pixels to cluster tiles
+	float clusterSliceScale;	// log(view depth) to depth slice
+	float clusterSliceBias;
+	uint3 clusterCounts;
 }
 
 Texture2D diffuseTexture	: register(t0);
+#if NORMAL_MAP
+Texture2D normalMap			: register(t1);
+#endif
+#if POINT_LIGHTS
+StructuredBuffer<PointLight> pointLights	: register(t2);
+StructuredBuffer<uint2> lightClusters		: register(t3); // (offset, count) into lightIndices
+StructuredBuffer<uint> lightIndices			: register(t4);
+#endif
 SamplerState samplerOptions	: register(s0);
 
 
@@ -24,19 +60,49 @@ SamplerState samplerOptions	: register(s0);
 //    "put the output of this into the current render target"
 // - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
-float4 main(VertexToPixel input) : SV_TARGET
+float4 main(PIXEL_INPUT input) : SV_TARGET
 {
 	// Just return the input color
 	// - This color (like most values passing through the rasterizer) is 
 	//   interpolated for each pixel between the corresponding vertices 
 	//   of the triangle we're rendering
+#if NORMAL_MAP
+	float3 unpackedNormal = normalMap.Sample(samplerOptions, input.uv).rgb * 2 - 1;
+	float3 N = normalize(input.normal);
+	float3 T = normalize(input.tangent);
+	T = normalize(T - N * dot(T, N));
+	float3 B = cross(T, N);
+	float3x3 TBN = float3x3(T, B, N);
+
+	input.normal = normalize(mul(unpackedNormal, TBN));
+#else
 	input.normal = normalize(input.normal);
+#endif
 
-	float3 lighting = CalculateLightingPoint(light4, cameraPosition, reflectivity, input.worldPos, input.normal)
-		+ CalculateLightingDirectional(light, cameraPosition, reflectivity, input.worldPos, input.normal)
+	float3 lighting = CalculateLightingDirectional(light, cameraPosition, reflectivity, input.worldPos, input.normal)
 		+ CalculateLightingDirectional(light2, cameraPosition, reflectivity, input.worldPos, input.normal)
 		+ CalculateLightingDirectional(light3, cameraPosition, reflectivity, input.worldPos, input.normal);
 
+#if POINT_LIGHTS
+	// Only the lights binned into this pixel's cluster.  The
+	// tile comes from the pixel position, the slice from the
+	// view depth (which is SV_POSITION's w)
+	uint2 tile = min((uint2)(input.position.xy * clusterTileScale), clusterCounts.xy - 1);
+	uint slice = (uint)clamp(log(input.position.w) * clusterSliceScale + clusterSliceBias, 0, clusterCounts.z - 1);
+	uint2 cluster = lightClusters[(slice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x];
+
+	for (uint i = 0; i < cluster.y; i++)
+		lighting += CalculateLightingPoint(pointLights[lightIndices[cluster.x + i]], cameraPosition, reflectivity, input.worldPos, input.normal);
+#endif
+
 	float3 surfaceColor = diffuseTexture.Sample(samplerOptions, input.uv).rgb;
-	return float4(lighting, 1) * input.color * float4(surfaceColor, 1);
+	float4 color = float4(lighting, 1) * input.color * float4(surfaceColor, 1);
+
+#if FOG
+	// Linear fog by distance from the camera
+	float fogAmount = saturate((distance(cameraPosition, input.worldPos) - fogStart) / (fogEnd - fogStart));
+	color.rgb = lerp(color.rgb, fogColor, fogAmount);
+#endif
+
+	return color;
 }
\ No newline at end of file
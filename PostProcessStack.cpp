@@ -0,0 +1,47 @@
+#include "PostProcessStack.h"
+
+PostProcessStack::PostProcessStack(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::wstring sourceFile,
+	std::wstring compiledPrefix)
+{
+	std::vector<ShaderFeature> features = {
+		{ "MOTION_BLUR", POST_EFFECT_MOTION_BLUR },
+		{ "TONEMAP", POST_EFFECT_TONEMAP },
+		{ "COLOR_GRADING", POST_EFFECT_COLOR_GRADING },
+		{ "VIGNETTE", POST_EFFECT_VIGNETTE } };
+
+	permutations = std::make_unique<ShaderPermutations>(device, context, ShaderStage::Pixel,
+		sourceFile, compiledPrefix, features);
+	effects = 0;
+
+	// Every combination is built with the project, so load them
+	// all now rather than on the frame an effect is toggled
+	unsigned int allEffects = permutations->GetSupportedMask();
+	for (unsigned int mask = 0; mask <= allEffects; mask++)
+		permutations->GetPixelShader(mask & allEffects);
+}
+
+void PostProcessStack::SetEffectEnabled(unsigned int effect, bool enabled)
+{
+	if (enabled)
+		effects |= effect;
+	else
+		effects &= ~effect;
+}
+
+std::shared_ptr<SimplePixelShader> PostProcessStack::GetShader(unsigned int effects)
+{
+	std::shared_ptr<SimplePixelShader> ps = permutations->GetPixelShader(effects);
+	if (!ps)
+		return nullptr;
+
+	ps->SetFloat("exposure", settings.Exposure);
+	ps->SetFloat("saturation", settings.Saturation);
+	ps->SetFloat("contrast", settings.Contrast);
+	ps->SetFloat3("colorFilter", settings.ColorFilter);
+	ps->SetFloat("vignetteStrength", settings.VignetteStrength);
+	ps->SetFloat("vignetteRadius", settings.VignetteRadius);
+	return ps;
+}
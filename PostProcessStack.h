@@ -0,0 +1,67 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+
+#include "ShaderPermutations.h"
+#include "SimpleShader.h"
+
+// Effects the uber post shader can apply.  Each maps to a
+// define in UberPostPS.hlsl
+#define POST_EFFECT_MOTION_BLUR			0x1 // Needs depth and velocity tiles (see Game::Draw)
+#define POST_EFFECT_TONEMAP				0x2
+#define POST_EFFECT_COLOR_GRADING		0x4
+#define POST_EFFECT_VIGNETTE			0x8
+
+// --------------------------------------------------------
+// Values for the per-pixel effects
+// --------------------------------------------------------
+struct PostProcessSettings
+{
+	float Exposure = 1.0f;
+	float Saturation = 1.0f;
+	float Contrast = 1.0f;
+	DirectX::XMFLOAT3 ColorFilter = DirectX::XMFLOAT3(1, 1, 1);
+	float VignetteStrength = 0.6f;
+	float VignetteRadius = 0.5f;	// Distance from the center (in screen heights) where darkening starts
+};
+
+// --------------------------------------------------------
+// The post effects that don't need neighbouring pixels,
+// fused into one full screen pass.
+//
+// Rather than a pass per effect, each combination of
+// enabled effects is its own variant of UberPostPS.hlsl
+// (built with the project and loaded up front), so the scene
+// is read once and the back buffer written once however
+// many effects are on.  Multi-pass effects (the Gaussian
+// blur) run before it and feed it their result.
+// --------------------------------------------------------
+class PostProcessStack
+{
+public:
+	PostProcessStack(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::wstring sourceFile,		// Path to UberPostPS.hlsl
+		std::wstring compiledPrefix);	// Path (without extension) for compiled variants
+
+	void SetEffectEnabled(unsigned int effect, bool enabled);
+	bool IsEffectEnabled(unsigned int effect) { return (effects & effect) != 0; }
+	unsigned int GetEffects() { return effects; }
+
+	PostProcessSettings& GetSettings() { return settings; }
+
+	// The variant for these effects (usually GetEffects() plus
+	// any the frame adds), with the settings already set.  Null
+	// if the variant failed to load
+	std::shared_ptr<SimplePixelShader> GetShader(unsigned int effects);
+
+private:
+	std::unique_ptr<ShaderPermutations> permutations;
+	unsigned int effects;
+	PostProcessSettings settings;
+};
@@ -0,0 +1,394 @@
+#include "RenderQueue.h"
+#include "BufferStructs.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+RenderQueue::RenderQueue(Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	this->device = device;
+	instanceCapacity = 0;
+	camera = 0;
+	interpolation = 1.0f;
+	XMStoreFloat4x4(&viewMatrix, XMMatrixIdentity());
+	XMStoreFloat4x4(&viewProjectionMatrix, XMMatrixIdentity());
+	nearClip = 0.0f;
+	farClip = 1.0f;
+	culledCount = 0;
+	occlusionCuller = 0;
+	depthPrePass = false;
+
+	// Shading after the pre-pass: only the pixels that won the
+	// depth test, and the depth is already written
+	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+	depthDesc.DepthEnable = true;
+	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
+	device->CreateDepthStencilState(&depthDesc, equalDepthState.GetAddressOf());
+}
+
+void RenderQueue::Begin(Camera* camera, float interpolation)
+{
+	this->camera = camera;
+	this->interpolation = interpolation;
+	viewMatrix = camera->GetViewMatrix();
+	nearClip = camera->GetNearClip();
+	farClip = camera->GetFarClip();
+	XMFLOAT4X4 projectionMatrix = camera->GetProjectionMatrix();
+	XMStoreFloat4x4(&viewProjectionMatrix, XMMatrixMultiply(XMLoadFloat4x4(&viewMatrix), XMLoadFloat4x4(&projectionMatrix)));
+	frustum.SetFromViewProjection(viewMatrix, projectionMatrix);
+
+	packets.clear();
+	boundsCenterX.clear();
+	boundsCenterY.clear();
+	boundsCenterZ.clear();
+	boundsExtentX.clear();
+	boundsExtentY.clear();
+	boundsExtentZ.clear();
+	culledCount = 0;
+}
+
+// --------------------------------------------------------
+// Builds the entity's sort key and world space bounds,
+// and queues it
+// --------------------------------------------------------
+void RenderQueue::Submit(Entity* entity, RenderPass pass)
+{
+	Material* material = entity->GetMaterial().get();
+	Mesh* mesh = entity->GetMesh().get();
+	XMFLOAT4X4 world = entity->GetTransform()->GetInterpolatedWorldMatrix(interpolation);
+
+	// Meshes without a collider (failed loads) are never culled
+	XMFLOAT3 center(world._41, world._42, world._43);
+	XMFLOAT3 extents(1e30f, 1e30f, 1e30f);
+	Collider* collider = mesh->GetCollider();
+	if (collider)
+		Frustum::TransformBox(collider->GetMin(), collider->GetMax(), world, &center, &extents);
+
+	boundsCenterX.push_back(center.x);
+	boundsCenterY.push_back(center.y);
+	boundsCenterZ.push_back(center.z);
+	boundsExtentX.push_back(extents.x);
+	boundsExtentY.push_back(extents.y);
+	boundsExtentZ.push_back(extents.z);
+
+	// View space depth, scaled to [0, 1] between the clip planes
+	XMFLOAT3 position(world._41, world._42, world._43);
+	XMVECTOR viewPos = XMVector3Transform(XMLoadFloat3(&position), XMLoadFloat4x4(&viewMatrix));
+	float depth = (XMVectorGetZ(viewPos) - nearClip) / (farClip - nearClip);
+
+	DrawPacket packet;
+	packet.Object = entity;
+	packet.SortKey = MakeSortKey(pass,
+		material->GetVertexShader()->GetId(),
+		material->GetPixelShader()->GetId(),
+		material->GetId(),
+		mesh->GetId(),
+		depth,
+		!depthPrePass,
+		material->GetInstancedVertexShader() != nullptr);
+	packets.push_back(packet);
+}
+
+uint64_t RenderQueue::MakeSortKey(RenderPass pass, unsigned int vertexShaderId, unsigned int pixelShaderId,
+	unsigned int materialId, unsigned int meshId, float depth, bool frontToBack, bool instanced)
+{
+	depth = (std::min)((std::max)(depth, 0.0f), 1.0f);
+
+	uint64_t key = (uint64_t)((unsigned int)pass & 0x3) << 62;
+	uint64_t shaders = ((uint64_t)(vertexShaderId & 0x7F) << 7) | (uint64_t)(pixelShaderId & 0x7F);
+
+	if (frontToBack)
+	{
+		// 16 bits of depth, split around the state bits.  Packets
+		// that can be instanced all go in the first coarse slice,
+		// sorted by state, so each mesh and material stays one run
+		// (one draw) instead of a draw per slice it spans; their
+		// fine depth is the top of the depth, so a run still draws
+		// front to back
+		unsigned int quantized = (unsigned int)(depth * 65535.0f);
+		unsigned int coarse = instanced ? 0 : quantized >> 10;
+		unsigned int fine = instanced ? quantized >> 6 : quantized & 0x3FF;
+		return key |
+			((uint64_t)coarse << 56) |
+			(shaders << 42) |
+			((uint64_t)(materialId & 0xFFFF) << 26) |
+			((uint64_t)(meshId & 0xFFFF) << 10) |
+			(uint64_t)fine;
+	}
+
+	return key |
+		(shaders << 48) |
+		((uint64_t)(materialId & 0xFFFF) << 32) |
+		((uint64_t)(meshId & 0xFFFF) << 16) |
+		(uint64_t)(depth * 65535.0f);
+}
+
+// --------------------------------------------------------
+// Tests every packet's bounds against the frustum in one
+// batch (and the survivors against the occlusion buffer),
+// then drops the packets that aren't visible
+// --------------------------------------------------------
+void RenderQueue::Cull()
+{
+	size_t count = packets.size();
+	visible.resize(count);
+
+	BoundsSoA bounds;
+	bounds.CenterX = boundsCenterX.data();
+	bounds.CenterY = boundsCenterY.data();
+	bounds.CenterZ = boundsCenterZ.data();
+	bounds.ExtentX = boundsExtentX.data();
+	bounds.ExtentY = boundsExtentY.data();
+	bounds.ExtentZ = boundsExtentZ.data();
+	frustum.TestBoxes(bounds, count, visible.data());
+	if (occlusionCuller)
+		occlusionCuller->TestBoxes(bounds, count, visible.data());
+
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (visible[i])
+			packets[kept++] = packets[i];
+	}
+
+	culledCount = count - kept;
+	packets.resize(kept);
+}
+
+// --------------------------------------------------------
+// LSD radix sort on the keys, a byte at a time.  Bytes that
+// are the same in every key (common, as most of a frame
+// shares a pass and a few shaders) are skipped
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	size_t count = packets.size();
+	if (count < 2)
+		return;
+
+	sortScratch.resize(count);
+	DrawPacket* source = packets.data();
+	DrawPacket* dest = sortScratch.data();
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		size_t offsets[256] = {};
+		for (size_t i = 0; i < count; i++)
+			offsets[(source[i].SortKey >> shift) & 0xFF]++;
+
+		if (offsets[(source[0].SortKey >> shift) & 0xFF] == count)
+			continue;
+
+		// Counts -> starting offsets
+		size_t total = 0;
+		for (unsigned int b = 0; b < 256; b++)
+		{
+			size_t bucketCount = offsets[b];
+			offsets[b] = total;
+			total += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dest[offsets[(source[i].SortKey >> shift) & 0xFF]++] = source[i];
+
+		std::swap(source, dest);
+	}
+
+	// Make sure the sorted result ends up in packets
+	if (source != packets.data())
+		packets.swap(sortScratch);
+}
+
+// --------------------------------------------------------
+// Works out every packet's world, inverse transpose world
+// (for normals) and world-view-projection matrices in one
+// pass, so the vertex shader doesn't multiply matrices
+// per vertex
+// --------------------------------------------------------
+void RenderQueue::ComputeObjectData()
+{
+	objectData.resize(packets.size());
+
+	XMMATRIX viewProjection = XMLoadFloat4x4(&viewProjectionMatrix);
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		Entity* entity = packets[i].Object;
+		InstanceData& data = objectData[i];
+
+		data.World = entity->GetTransform()->GetInterpolatedWorldMatrix(interpolation);
+		XMMATRIX world = XMLoadFloat4x4(&data.World);
+
+		XMStoreFloat4x4(&data.WorldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(0, world)));
+		XMStoreFloat4x4(&data.WorldViewProjection, XMMatrixMultiply(world, viewProjection));
+		data.ColorTint = entity->GetMaterial()->GetColorTint();
+	}
+}
+
+// --------------------------------------------------------
+// Fills the instance buffer (growing it if needed) and
+// binds it to input slot 1.  Returns false if there's no
+// buffer to use, in which case nothing is instanced
+// --------------------------------------------------------
+bool RenderQueue::WriteInstanceData(ID3D11DeviceContext* context)
+{
+	if (packets.size() > instanceCapacity)
+	{
+		size_t capacity = instanceCapacity > 0 ? instanceCapacity : 64;
+		while (capacity < packets.size())
+			capacity *= 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = (UINT)(capacity * sizeof(InstanceData));
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		instanceBuffer.Reset();
+		instanceCapacity = 0;
+		if (FAILED(device->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf())))
+			return false;
+		instanceCapacity = capacity;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+
+	memcpy(mapped.pData, objectData.data(), objectData.size() * sizeof(InstanceData));
+
+	context->Unmap(instanceBuffer.Get(), 0);
+
+	UINT stride = sizeof(InstanceData);
+	UINT offset = 0;
+	context->IASetVertexBuffers(1, 1, instanceBuffer.GetAddressOf(), &stride, &offset);
+	return true;
+}
+
+void RenderQueue::Execute(ID3D11DeviceContext* context)
+{
+	Cull();
+	Sort();
+	if (packets.empty())
+		return;
+
+	ComputeObjectData();
+	bool instancing = WriteInstanceData(context);
+
+	if (depthPrePass)
+	{
+		DrawPackets(context, instancing, true);
+
+		context->OMSetDepthStencilState(equalDepthState.Get(), 0);
+		DrawPackets(context, instancing, false);
+		context->OMSetDepthStencilState(0, 0);
+	}
+	else
+	{
+		DrawPackets(context, instancing, false);
+	}
+}
+
+// --------------------------------------------------------
+// Draws the sorted packets.  Shaders are set when they
+// change, material data and resources when the material
+// changes, and vertex/index buffers when the mesh changes.
+//
+// Each run of packets sharing a mesh and material is one
+// instanced draw if the material has an instanced vertex
+// shader; otherwise the run is drawn one packet at a time,
+// setting the per-object vertex shader data for each.
+//
+// Depth-only draws use the same vertex shaders (so depths
+// match exactly for the EQUAL test) with no pixel shader
+// --------------------------------------------------------
+void RenderQueue::DrawPackets(ID3D11DeviceContext* context, bool instancing, bool depthOnly)
+{
+	if (depthOnly)
+		context->PSSetShader(0, 0, 0);
+
+	SimpleVertexShader* currentVS = 0;
+	SimplePixelShader* currentPS = 0;
+	Material* currentMaterial = 0;
+	Mesh* currentMesh = 0;
+
+	size_t start = 0;
+	while (start < packets.size())
+	{
+		Material* material = packets[start].Object->GetMaterial().get();
+		Mesh* mesh = packets[start].Object->GetMesh().get();
+
+		// Find the end of this run of packets with the same mesh and material
+		size_t end = start + 1;
+		while (end < packets.size() &&
+			packets[end].Object->GetMaterial().get() == material &&
+			packets[end].Object->GetMesh().get() == mesh)
+			end++;
+
+		SimpleVertexShader* instancedVS = instancing ? material->GetInstancedVertexShader().get() : 0;
+		SimpleVertexShader* vs = instancedVS ? instancedVS : material->GetVertexShader().get();
+		SimplePixelShader* ps = material->GetPixelShader().get();
+
+		if (vs != currentVS)
+		{
+			vs->SetShader();
+			currentVS = vs;
+		}
+
+		if (!depthOnly && ps != currentPS)
+		{
+			ps->SetShader();
+			currentPS = ps;
+			currentMaterial = 0; // New shader needs the material's data too
+		}
+
+		if (!depthOnly && material != currentMaterial)
+		{
+			ps->SetFloat("reflectivity", material->GetReflectivity());
+			ps->SetSamplerState("samplerOptions", material->GetSamplerState().Get());
+			ps->SetShaderResourceView("diffuseTexture", material->GetShaderResource().Get());
+			if (material->IsNormalMap())
+				ps->SetShaderResourceView("normalMap", material->GetNormalMap().Get());
+
+			ps->FlushResources();
+			ps->CopyAllBufferData();
+			currentMaterial = material;
+		}
+
+		if (mesh != currentMesh)
+		{
+			UINT stride = sizeof(Vertex);
+			UINT offset = 0;
+			context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer().GetAddressOf(), &stride, &offset);
+			context->IASetIndexBuffer(mesh->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+			currentMesh = mesh;
+		}
+
+		if (instancedVS)
+		{
+			// The run's instance data starts at its first packet's index
+			context->DrawIndexedInstanced(mesh->GetIndexCount(), (UINT)(end - start), 0, 0, (UINT)start);
+		}
+		else
+		{
+			for (size_t i = start; i < end; i++)
+			{
+				// Per object data, copied in one go
+				VertexShaderExternalData vsData;
+				vsData.colorTint = objectData[i].ColorTint;
+				vsData.worldMatrix = objectData[i].World;
+				vsData.worldInverseTransposeMatrix = objectData[i].WorldInverseTranspose;
+				vsData.worldViewProjectionMatrix = objectData[i].WorldViewProjection;
+				vs->SetStruct("ExternalData", vsData);
+				vs->CopyAllBufferData();
+
+				context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
+			}
+		}
+
+		start = end;
+	}
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "Entity.h"
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+
+// Passes are the most significant part of the sort key,
+// so every packet in one pass draws before the next pass
+enum class RenderPass
+{
+	Opaque = 0
+};
+
+// --------------------------------------------------------
+// Per object vertex data, computed once a frame for every
+// packet.  Also the per instance vertex data (input slot 1),
+// matching InstancedVertexShaderInput in VertexShader.hlsl
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+	DirectX::XMFLOAT4X4 WorldViewProjection;
+	DirectX::XMFLOAT4 ColorTint;
+};
+
+// --------------------------------------------------------
+// One submitted draw: the entity and the key it sorts by
+// --------------------------------------------------------
+struct DrawPacket
+{
+	uint64_t SortKey;
+	Entity* Object;
+};
+
+// --------------------------------------------------------
+// Collects each frame's draws, sorts them by a 64 bit key
+// and draws them, only changing shaders, material resources
+// or mesh buffers between packets that actually differ.
+//
+// Without a depth pre-pass, opaque draws go roughly front
+// to back, so later draws fail the depth test instead of
+// shading pixels that end up hidden.  Key layout (most to
+// least significant):
+//   63-62  pass
+//   61-56  coarse view depth (64 slices between the clip planes)
+//   55-42  shaders (7 bits of vertex + 7 of pixel shader id)
+//   41-26  material id
+//   25-10  mesh id
+//   9-0    fine view depth
+//
+// Except for packets whose material has an instanced vertex
+// shader: they all get coarse depth 0 (and the top 10 bits of
+// depth as fine depth), so they draw first, grouped by state.
+// Slicing them by depth would split a mesh's instances into a
+// draw per slice they span, undoing the instancing.
+//
+// With the pre-pass, depth is laid down first and shading
+// only runs on the visible surface (an EQUAL depth test),
+// so draw order doesn't matter for overdraw and the key
+// sorts purely to minimize state changes:
+//   63-62  pass
+//   61-48  shaders
+//   47-32  material id
+//   31-16  mesh id
+//   15-0   view depth
+//
+// Ids are truncated to fit, so two different shaders or
+// materials can share a key value - they still draw
+// correctly, as state changes compare the actual objects.
+//
+// Before sorting, packets whose mesh bounds (in world space)
+// are entirely outside the camera's frustum, or hidden by
+// the occlusion culler's occluders, are dropped.
+//
+// After sorting, runs of packets with the same mesh and
+// material are drawn with one DrawIndexedInstanced, using
+// the material's instanced vertex shader, if it has one.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	// Clears last frame's packets; depths and culling use this camera.
+	// Entities are drawn blended between their previous and current
+	// simulation tick by interpolation (see DXCore::GetInterpolation())
+	void Begin(Camera* camera, float interpolation = 1.0f);
+	void Submit(Entity* entity, RenderPass pass = RenderPass::Opaque);
+
+	// Culls, sorts and draws the packets.  Per-frame pixel
+	// shader data (lights, etc.) should already be set
+	void Execute(ID3D11DeviceContext* context);
+
+	size_t GetPacketCount() { return packets.size(); }
+	size_t GetCulledCount() { return culledCount; }
+
+	// Draws every packet depth-only first, then shades them with
+	// an EQUAL depth test.  Takes effect from the next Submit()
+	void SetDepthPrePass(bool enabled) { depthPrePass = enabled; }
+	bool GetDepthPrePass() { return depthPrePass; }
+
+	// Optional; must be rasterized for the same camera before Execute()
+	void SetOcclusionCuller(OcclusionCuller* culler) { occlusionCuller = culler; }
+
+	// Depth is [0, 1] between the clip planes.  Instanced packets
+	// ignore frontToBack's depth slices (see above)
+	static uint64_t MakeSortKey(RenderPass pass, unsigned int vertexShaderId, unsigned int pixelShaderId,
+		unsigned int materialId, unsigned int meshId, float depth, bool frontToBack, bool instanced);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Camera* camera;
+	float interpolation;
+
+	bool depthPrePass;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> equalDepthState;
+	DirectX::XMFLOAT4X4 viewMatrix;
+	DirectX::XMFLOAT4X4 viewProjectionMatrix;
+	float nearClip;
+	float farClip;
+
+	// Kept between frames so submitting doesn't allocate
+	std::vector<DrawPacket> packets;
+	std::vector<DrawPacket> sortScratch;
+
+	// World space bounds of each packet, in submission order
+	Frustum frustum;
+	OcclusionCuller* occlusionCuller;
+	std::vector<float> boundsCenterX, boundsCenterY, boundsCenterZ;
+	std::vector<float> boundsExtentX, boundsExtentY, boundsExtentZ;
+	std::vector<uint8_t> visible;
+	size_t culledCount;
+
+	// Each packet's matrices, in sorted order
+	std::vector<InstanceData> objectData;
+
+	// Dynamic buffer holding a copy of objectData
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	size_t instanceCapacity;
+
+	void Cull();
+	void Sort();
+	void ComputeObjectData();
+	bool WriteInstanceData(ID3D11DeviceContext* context);
+	void DrawPackets(ID3D11DeviceContext* context, bool instancing, bool depthOnly);
+};
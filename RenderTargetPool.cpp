@@ -0,0 +1,122 @@
+#include "RenderTargetPool.h"
+
+RenderTargetPool::RenderTargetPool(Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	this->device = device;
+	frame = 0;
+}
+
+RenderTarget* RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+	for (auto& entry : entries)
+	{
+		if (!entry->InUse && entry->Target.Desc == desc)
+		{
+			entry->InUse = true;
+			entry->LastUsedFrame = frame;
+			return &entry->Target;
+		}
+	}
+
+	std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+	if (!CreateTarget(desc, &entry->Target))
+		return 0;
+
+	entry->InUse = true;
+	entry->LastUsedFrame = frame;
+	entries.push_back(std::move(entry));
+	return &entries.back()->Target;
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+	for (auto& entry : entries)
+	{
+		if (&entry->Target == target)
+		{
+			entry->InUse = false;
+			return;
+		}
+	}
+}
+
+void RenderTargetPool::Retain(const RenderTargetDesc& desc)
+{
+	for (auto& entry : entries)
+	{
+		if (!entry->InUse && entry->Target.Desc == desc)
+		{
+			entry->LastUsedFrame = frame;
+			return;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Frees targets that haven't been handed out recently
+// (e.g. ones sized for the window before a resize)
+// --------------------------------------------------------
+void RenderTargetPool::EndFrame()
+{
+	for (size_t i = entries.size(); i-- > 0; )
+	{
+		if (!entries[i]->InUse && frame - entries[i]->LastUsedFrame >= MaxUnusedFrames)
+			entries.erase(entries.begin() + i);
+	}
+
+	frame++;
+}
+
+size_t RenderTargetPool::GetMemoryUsage()
+{
+	size_t bytes = 0;
+	for (auto& entry : entries)
+	{
+		// Close enough for the formats we use (4 bytes per pixel,
+		// except half float RGBA)
+		const RenderTargetDesc& desc = entry->Target.Desc;
+		size_t pixelSize = desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT ? 8 : 4;
+		bytes += (size_t)desc.Width * desc.Height * pixelSize;
+	}
+	return bytes;
+}
+
+bool RenderTargetPool::CreateTarget(const RenderTargetDesc& desc, RenderTarget* target)
+{
+	target->Desc = desc;
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.Width;
+	textureDesc.Height = desc.Height;
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = desc.BindFlags;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.Format = desc.Format;
+	textureDesc.MipLevels = 1;
+	textureDesc.MiscFlags = 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	if (FAILED(device->CreateTexture2D(&textureDesc, 0, target->Texture.GetAddressOf())))
+		return false;
+
+	// Views use the texture's own format (null descs)
+	if ((desc.BindFlags & D3D11_BIND_RENDER_TARGET) &&
+		FAILED(device->CreateRenderTargetView(target->Texture.Get(), 0, target->RTV.GetAddressOf())))
+		return false;
+
+	if ((desc.BindFlags & D3D11_BIND_DEPTH_STENCIL) &&
+		FAILED(device->CreateDepthStencilView(target->Texture.Get(), 0, target->DSV.GetAddressOf())))
+		return false;
+
+	if ((desc.BindFlags & D3D11_BIND_SHADER_RESOURCE) &&
+		FAILED(device->CreateShaderResourceView(target->Texture.Get(), 0, target->SRV.GetAddressOf())))
+		return false;
+
+	if ((desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS) &&
+		FAILED(device->CreateUnorderedAccessView(target->Texture.Get(), 0, target->UAV.GetAddressOf())))
+		return false;
+
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// What a pooled target looks like.  Targets are only shared
+// between requests with exactly the same description
+// --------------------------------------------------------
+struct RenderTargetDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	DXGI_FORMAT Format;
+	unsigned int BindFlags; // D3D11_BIND_RENDER_TARGET, _DEPTH_STENCIL, _SHADER_RESOURCE, _UNORDERED_ACCESS
+
+	bool operator==(const RenderTargetDesc& other) const
+	{
+		return Width == other.Width && Height == other.Height &&
+			Format == other.Format && BindFlags == other.BindFlags;
+	}
+};
+
+// --------------------------------------------------------
+// A texture plus a view for each of its bind flags
+// --------------------------------------------------------
+struct RenderTarget
+{
+	RenderTargetDesc Desc;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RTV;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> UAV;
+};
+
+// --------------------------------------------------------
+// Hands out transient render targets and recycles them.
+//
+// A pass Acquire()s what it needs and Release()s it as soon
+// as nothing later in the frame reads it; the next request
+// with the same description gets that texture back, so
+// targets whose lifetimes don't overlap share memory.
+// Nothing is recreated on resize - targets of the old size
+// simply stop being asked for, and EndFrame() frees any
+// target that's sat unused for a few frames.
+// --------------------------------------------------------
+class RenderTargetPool
+{
+public:
+	// How many frames an unused target survives
+	static const unsigned int MaxUnusedFrames = 8;
+
+	RenderTargetPool(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	// Null if a new target had to be created and that failed
+	RenderTarget* Acquire(const RenderTargetDesc& desc);
+	void Release(RenderTarget* target);
+
+	// Keeps an idle target with this description from being
+	// freed this frame, for targets that are only needed now
+	// and then but shouldn't be recreated each time
+	void Retain(const RenderTargetDesc& desc);
+
+	// Call once per frame, after the frame's last Release()
+	void EndFrame();
+
+	size_t GetTargetCount() { return entries.size(); }
+	size_t GetMemoryUsage(); // Approximate bytes held
+
+private:
+	struct Entry
+	{
+		RenderTarget Target;
+		bool InUse;
+		unsigned long long LastUsedFrame;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::vector<std::unique_ptr<Entry>> entries;
+	unsigned long long frame;
+
+	bool CreateTarget(const RenderTargetDesc& desc, RenderTarget* target);
+};
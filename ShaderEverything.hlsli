@@ -1,5 +1,6 @@
 #ifndef __GGP_SHADER_INCLUDES__
 #define __GGP_SHADER_INCLUDES__
+
 //Directional Light struct
 struct DirectionalLight
 {
@@ -18,7 +19,7 @@ struct PointLight
 	float3 diffuseColor;
 	float padding2;
 	float3 position;
-	float padding3;
+	float range;
 };
 
 // Struct representing the data we expect to receive from earlier pipeline stages
@@ -98,9 +99,17 @@ float3 CalculateLightingDirectional(DirectionalLight l, float3 cameraPosition, f
 	return CalculateLighting(l.direction, l.ambientColor, l.diffuseColor, cameraPosition, reflectivity, worldPos, normal);
 }
 
+// Smooth falloff that reaches zero at the light's range, so
+// light clustering can ignore pixels farther away
+float Attenuate(PointLight l, float3 worldPos) {
+	float dist = distance(l.position, worldPos);
+	float att = saturate(1.0f - (dist * dist / (l.range * l.range)));
+	return att * att;
+}
+
 float3 CalculateLightingPoint(PointLight l, float3 cameraPosition, float reflectivity, float3 worldPos, float3 normal) {
 	float3 lightDir = normalize(worldPos - l.position);
-	return CalculateLighting(lightDir, l.ambientColor, l.diffuseColor, cameraPosition, reflectivity, worldPos, normal);
+	return CalculateLighting(lightDir, l.ambientColor, l.diffuseColor, cameraPosition, reflectivity, worldPos, normal) * Attenuate(l, worldPos);
 }
 
 // Struct representing a single vertex worth of data
@@ -0,0 +1,230 @@
+#include "ShaderPermutations.h"
+
+#include <d3dcompiler.h>
+#include <stdio.h>
+
+// --------------------------------------------------------
+// Gets a file's last write time, returning false if the
+// file doesn't exist
+// --------------------------------------------------------
+static bool GetLastWriteTime(const std::wstring& path, ULONGLONG* time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+		return false;
+
+	*time = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+// --------------------------------------------------------
+// Newest write time of a shader source and the include
+// files (*.hlsli) that sit next to it
+// --------------------------------------------------------
+static bool GetSourceWriteTime(const std::wstring& sourceFile, ULONGLONG* time)
+{
+	if (!GetLastWriteTime(sourceFile, time))
+		return false;
+
+	size_t slash = sourceFile.find_last_of(L"\\/");
+	std::wstring directory = slash == std::wstring::npos ? L"" : sourceFile.substr(0, slash + 1);
+
+	WIN32_FIND_DATAW found;
+	HANDLE search = FindFirstFileW((directory + L"*.hlsli").c_str(), &found);
+	if (search != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			ULONGLONG includeTime = ((ULONGLONG)found.ftLastWriteTime.dwHighDateTime << 32) | found.ftLastWriteTime.dwLowDateTime;
+			if (includeTime > *time)
+				*time = includeTime;
+		} while (FindNextFileW(search, &found));
+		FindClose(search);
+	}
+
+	return true;
+}
+
+ShaderPermutations::ShaderPermutations(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	ShaderStage stage,
+	std::wstring sourceFile,
+	std::wstring compiledPrefix,
+	std::vector<ShaderFeature> features)
+{
+	this->device = device;
+	this->context = context;
+	this->stage = stage;
+	this->sourceFile = sourceFile;
+	this->compiledPrefix = compiledPrefix;
+	this->features = features;
+
+	supportedMask = 0;
+	for (const ShaderFeature& feature : features)
+		supportedMask |= feature.Mask;
+}
+
+std::shared_ptr<SimpleVertexShader> ShaderPermutations::GetVertexShader(unsigned int featureMask)
+{
+	if (stage != ShaderStage::Vertex)
+		return nullptr;
+
+	return std::static_pointer_cast<SimpleVertexShader>(GetVariant(featureMask));
+}
+
+std::shared_ptr<SimplePixelShader> ShaderPermutations::GetPixelShader(unsigned int featureMask)
+{
+	if (stage != ShaderStage::Pixel)
+		return nullptr;
+
+	return std::static_pointer_cast<SimplePixelShader>(GetVariant(featureMask));
+}
+
+std::vector<std::shared_ptr<SimpleVertexShader>> ShaderPermutations::GetLoadedVertexShaders()
+{
+	std::vector<std::shared_ptr<SimpleVertexShader>> shaders;
+	if (stage == ShaderStage::Vertex)
+	{
+		for (auto& variant : variants)
+			if (variant.second)
+				shaders.push_back(std::static_pointer_cast<SimpleVertexShader>(variant.second));
+	}
+	return shaders;
+}
+
+std::vector<std::shared_ptr<SimplePixelShader>> ShaderPermutations::GetLoadedPixelShaders()
+{
+	std::vector<std::shared_ptr<SimplePixelShader>> shaders;
+	if (stage == ShaderStage::Pixel)
+	{
+		for (auto& variant : variants)
+			if (variant.second)
+				shaders.push_back(std::static_pointer_cast<SimplePixelShader>(variant.second));
+	}
+	return shaders;
+}
+
+// --------------------------------------------------------
+// Looks up (or lazily loads) the variant for a feature mask.
+// Bits this source doesn't use are ignored, so materials
+// that only differ in those share a variant.
+// --------------------------------------------------------
+std::shared_ptr<ISimpleShader> ShaderPermutations::GetVariant(unsigned int featureMask)
+{
+	featureMask &= supportedMask;
+
+	auto it = variants.find(featureMask);
+	if (it != variants.end())
+		return it->second;
+
+	// Failures are cached too, so we don't retry every frame
+	std::shared_ptr<ISimpleShader> shader = LoadVariant(featureMask);
+	variants[featureMask] = shader;
+	return shader;
+}
+
+// --------------------------------------------------------
+// Loads a variant from its .cso, which the project builds
+// for every variant.  Compiling the source is a development
+// fallback: debug builds recompile a .cso that's older than
+// its source (so shader edits show up without a rebuild),
+// and any build compiles a variant whose .cso is missing.
+// --------------------------------------------------------
+std::shared_ptr<ISimpleShader> ShaderPermutations::LoadVariant(unsigned int featureMask)
+{
+	std::wstring compiledFile = featureMask == 0 ?
+		compiledPrefix + L".cso" :
+		compiledPrefix + L"_" + std::to_wstring(featureMask) + L".cso";
+
+	// Is the compiled variant missing (or, while developing,
+	// older than the source)?
+	ULONGLONG compiledTime = 0;
+	bool haveCompiled = GetLastWriteTime(compiledFile, &compiledTime);
+	bool upToDate = haveCompiled;
+#if defined(DEBUG) || defined(_DEBUG)
+	ULONGLONG sourceTime = 0;
+	if (haveCompiled && GetSourceWriteTime(sourceFile, &sourceTime))
+		upToDate = compiledTime >= sourceTime;
+#endif
+
+	Microsoft::WRL::ComPtr<ID3DBlob> blob;
+	ShaderReflectionData reflection;
+	if (upToDate)
+	{
+		if (!ISimpleShader::ReadShaderFile(compiledFile.c_str(), blob.GetAddressOf(), reflection))
+			return nullptr;
+	}
+	else
+	{
+		if (!CompileVariant(featureMask, blob.GetAddressOf()))
+			return nullptr;
+
+		// Save it for next time (not fatal if we can't)
+		D3DWriteBlobToFile(blob.Get(), compiledFile.c_str(), TRUE);
+
+		if (!ISimpleShader::ReflectShaderBlob(blob.Get(), reflection))
+			return nullptr;
+	}
+
+	std::shared_ptr<ISimpleShader> shader;
+	if (stage == ShaderStage::Vertex)
+		shader = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), blob.Get(), reflection);
+	else
+		shader = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), blob.Get(), reflection);
+
+	return shader->IsShaderValid() ? shader : nullptr;
+}
+
+// --------------------------------------------------------
+// Compiles the source with one define per feature
+// --------------------------------------------------------
+bool ShaderPermutations::CompileVariant(unsigned int featureMask, ID3DBlob** blob)
+{
+	// Every feature gets a define (0 when off), so the
+	// shaders can simply use "#if FEATURE"
+	std::vector<std::string> values;
+	for (const ShaderFeature& feature : features)
+	{
+		unsigned int shift = 0;
+		while (shift < 31 && !(feature.Mask & (1u << shift)))
+			shift++;
+
+		values.push_back(std::to_string((featureMask & feature.Mask) >> shift));
+	}
+
+	std::vector<D3D_SHADER_MACRO> defines;
+	for (size_t i = 0; i < features.size(); i++)
+	{
+		D3D_SHADER_MACRO macro = { features[i].Define.c_str(), values[i].c_str() };
+		defines.push_back(macro);
+	}
+	D3D_SHADER_MACRO terminator = { 0, 0 };
+	defines.push_back(terminator);
+
+	unsigned int flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined(DEBUG) || defined(_DEBUG)
+	flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+	Microsoft::WRL::ComPtr<ID3DBlob> errors;
+	HRESULT hr = D3DCompileFromFile(
+		sourceFile.c_str(),
+		&defines[0],
+		D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		"main",
+		stage == ShaderStage::Vertex ? "vs_5_0" : "ps_5_0",
+		flags,
+		0,
+		blob,
+		errors.GetAddressOf());
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (errors)
+		printf("%s\n", (const char*)errors->GetBufferPointer());
+#endif
+
+	return SUCCEEDED(hr);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// One feature of a shader source, mapped to a define.
+// Mask selects the feature's bits in a feature bitmask; the
+// define's value is those bits shifted down, so multi-bit
+// masks can hold small counts (e.g. number of point lights)
+// --------------------------------------------------------
+struct ShaderFeature
+{
+	std::string Define;
+	unsigned int Mask;
+};
+
+enum class ShaderStage { Vertex, Pixel };
+
+// --------------------------------------------------------
+// All compiled variants of one shader source, keyed by a
+// feature bitmask (usually from Material::GetShaderFeatures()).
+//
+// Variants are created the first time they're asked for and
+// then cached.  Each is loaded from "<prefix>_<mask>.cso",
+// which the project builds (the ShaderVariant items in
+// DX11Starter.vcxproj); the all-features-off variant is
+// "<prefix>.cso", the project's normal shader build.
+//
+// As a development fallback, a variant whose .cso is missing
+// (or, in debug builds, older than the source) is compiled
+// from the source with the matching defines, and the .cso
+// is written out so later runs can skip the compile.
+// --------------------------------------------------------
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		ShaderStage stage,
+		std::wstring sourceFile,		// Path to the .hlsl file
+		std::wstring compiledPrefix,	// Path (without extension) for compiled variants
+		std::vector<ShaderFeature> features);
+
+	// Null if this source isn't the requested stage
+	// or the variant failed to load
+	std::shared_ptr<SimpleVertexShader> GetVertexShader(unsigned int featureMask);
+	std::shared_ptr<SimplePixelShader> GetPixelShader(unsigned int featureMask);
+
+	// Every variant created so far (for setting per-frame data)
+	std::vector<std::shared_ptr<SimpleVertexShader>> GetLoadedVertexShaders();
+	std::vector<std::shared_ptr<SimplePixelShader>> GetLoadedPixelShaders();
+
+	// The bits of any feature mask this source cares about
+	unsigned int GetSupportedMask() { return supportedMask; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	ShaderStage stage;
+	std::wstring sourceFile;
+	std::wstring compiledPrefix;
+	std::vector<ShaderFeature> features;
+	unsigned int supportedMask;
+
+	std::unordered_map<unsigned int, std::shared_ptr<ISimpleShader>> variants;
+
+	std::shared_ptr<ISimpleShader> GetVariant(unsigned int featureMask);
+	std::shared_ptr<ISimpleShader> LoadVariant(unsigned int featureMask);
+	bool CompileVariant(unsigned int featureMask, ID3DBlob** blob);
+};
@@ -0,0 +1,261 @@
+#include "ShaderReflectionData.h"
+
+// Cache file layout:
+//   u32 magic, u32 version, u64 content hash, u32 payload size, payload
+static const uint32_t ReflectionCacheMagic = 0x4C464552; // "REFL"
+static const uint32_t ReflectionCacheVersion = 1;
+static const size_t ReflectionCacheHeaderSize = 4 + 4 + 8 + 4;
+
+// --------------------------------------------------------
+// Little-endian writer for the cache payload
+// --------------------------------------------------------
+namespace
+{
+	struct Writer
+	{
+		std::vector<unsigned char>& out;
+
+		void U32(uint32_t v)
+		{
+			for (int i = 0; i < 4; i++)
+				out.push_back((unsigned char)(v >> (i * 8)));
+		}
+
+		void U64(uint64_t v)
+		{
+			for (int i = 0; i < 8; i++)
+				out.push_back((unsigned char)(v >> (i * 8)));
+		}
+
+		void String(const std::string& s)
+		{
+			U32((uint32_t)s.size());
+			out.insert(out.end(), s.begin(), s.end());
+		}
+
+		void Parameters(const std::vector<ShaderReflectionParameter>& params)
+		{
+			U32((uint32_t)params.size());
+			for (const ShaderReflectionParameter& p : params)
+			{
+				String(p.SemanticName);
+				U32(p.SemanticIndex);
+				U32(p.Register);
+				U32(p.ComponentType);
+				U32(p.Mask);
+				U32(p.Stream);
+			}
+		}
+	};
+
+	// Bounds-checked reader; any overrun sets "ok" to false
+	// and every later read returns zeros
+	struct Reader
+	{
+		const unsigned char* bytes;
+		size_t size;
+		size_t pos;
+		bool ok;
+
+		bool Has(size_t count)
+		{
+			if (!ok || size - pos < count)
+				ok = false;
+			return ok;
+		}
+
+		uint32_t U32()
+		{
+			if (!Has(4)) return 0;
+			uint32_t v = 0;
+			for (int i = 0; i < 4; i++)
+				v |= (uint32_t)bytes[pos++] << (i * 8);
+			return v;
+		}
+
+		uint64_t U64()
+		{
+			if (!Has(8)) return 0;
+			uint64_t v = 0;
+			for (int i = 0; i < 8; i++)
+				v |= (uint64_t)bytes[pos++] << (i * 8);
+			return v;
+		}
+
+		std::string String()
+		{
+			uint32_t length = U32();
+			if (!Has(length)) return std::string();
+			std::string s((const char*)bytes + pos, length);
+			pos += length;
+			return s;
+		}
+
+		// Reads an element count, rejecting counts that couldn't
+		// possibly fit in the remaining bytes (each element is
+		// at least minElementSize bytes) before anything is allocated
+		uint32_t Count(size_t minElementSize)
+		{
+			uint32_t count = U32();
+			if (ok && (size - pos) / minElementSize < count)
+				ok = false;
+			return ok ? count : 0;
+		}
+
+		void Parameters(std::vector<ShaderReflectionParameter>& params)
+		{
+			uint32_t count = Count(4 * 6);
+			params.resize(count);
+			for (ShaderReflectionParameter& p : params)
+			{
+				p.SemanticName = String();
+				p.SemanticIndex = U32();
+				p.Register = U32();
+				p.ComponentType = U32();
+				p.Mask = U32();
+				p.Stream = U32();
+			}
+		}
+	};
+}
+
+// --------------------------------------------------------
+// Resets the data to an empty shader
+// --------------------------------------------------------
+void ShaderReflectionData::Clear()
+{
+	ConstantBuffers.clear();
+	Resources.clear();
+	InputParameters.clear();
+	OutputParameters.clear();
+	ThreadsX = ThreadsY = ThreadsZ = 0;
+}
+
+// --------------------------------------------------------
+// 64-bit FNV-1a hash
+// --------------------------------------------------------
+uint64_t ShaderReflectionSerializer::HashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Writes the header and reflection data to "out"
+// (replacing its contents)
+// --------------------------------------------------------
+void ShaderReflectionSerializer::Serialize(const ShaderReflectionData& data, uint64_t contentHash, std::vector<unsigned char>& out)
+{
+	out.clear();
+	Writer w = { out };
+
+	// Header - payload size is patched in at the end
+	w.U32(ReflectionCacheMagic);
+	w.U32(ReflectionCacheVersion);
+	w.U64(contentHash);
+	w.U32(0);
+
+	w.U32((uint32_t)data.ConstantBuffers.size());
+	for (const ShaderReflectionBuffer& cb : data.ConstantBuffers)
+	{
+		w.String(cb.Name);
+		w.U32(cb.Size);
+		w.U32(cb.BindIndex);
+		w.U32((uint32_t)cb.Variables.size());
+		for (const ShaderReflectionVariable& v : cb.Variables)
+		{
+			w.String(v.Name);
+			w.U32(v.ByteOffset);
+			w.U32(v.Size);
+		}
+	}
+
+	w.U32((uint32_t)data.Resources.size());
+	for (const ShaderReflectionResource& r : data.Resources)
+	{
+		w.String(r.Name);
+		w.U32(r.Type);
+		w.U32(r.BindIndex);
+	}
+
+	w.Parameters(data.InputParameters);
+	w.Parameters(data.OutputParameters);
+
+	w.U32(data.ThreadsX);
+	w.U32(data.ThreadsY);
+	w.U32(data.ThreadsZ);
+
+	// Patch the payload size
+	uint32_t payloadSize = (uint32_t)(out.size() - ReflectionCacheHeaderSize);
+	for (int i = 0; i < 4; i++)
+		out[ReflectionCacheHeaderSize - 4 + i] = (unsigned char)(payloadSize >> (i * 8));
+}
+
+// --------------------------------------------------------
+// Parses a cache produced by Serialize().  "out" is only
+// guaranteed to be meaningful when this returns true.
+// --------------------------------------------------------
+bool ShaderReflectionSerializer::Deserialize(const unsigned char* bytes, size_t size, uint64_t expectedHash, ShaderReflectionData& out)
+{
+	out.Clear();
+	if (!bytes)
+		return false;
+
+	Reader r = { bytes, size, 0, true };
+
+	// Validate the header before touching the payload
+	if (r.U32() != ReflectionCacheMagic) return false;
+	if (r.U32() != ReflectionCacheVersion) return false;
+	if (r.U64() != expectedHash) return false;
+	uint32_t payloadSize = r.U32();
+	if (!r.ok || size - r.pos != payloadSize) return false;
+
+	out.ConstantBuffers.resize(r.Count(4 * 4));
+	for (ShaderReflectionBuffer& cb : out.ConstantBuffers)
+	{
+		cb.Name = r.String();
+		cb.Size = r.U32();
+		cb.BindIndex = r.U32();
+		cb.Variables.resize(r.Count(4 * 3));
+		for (ShaderReflectionVariable& v : cb.Variables)
+		{
+			v.Name = r.String();
+			v.ByteOffset = r.U32();
+			v.Size = r.U32();
+
+			// A variable outside its buffer means a corrupt cache
+			if (v.ByteOffset > cb.Size || v.Size > cb.Size - v.ByteOffset)
+				r.ok = false;
+		}
+	}
+
+	out.Resources.resize(r.Count(4 * 3));
+	for (ShaderReflectionResource& res : out.Resources)
+	{
+		res.Name = r.String();
+		res.Type = r.U32();
+		res.BindIndex = r.U32();
+	}
+
+	r.Parameters(out.InputParameters);
+	r.Parameters(out.OutputParameters);
+
+	out.ThreadsX = r.U32();
+	out.ThreadsY = r.U32();
+	out.ThreadsZ = r.U32();
+
+	// Everything read and nothing left over?
+	if (!r.ok || r.pos != size)
+	{
+		out.Clear();
+		return false;
+	}
+
+	return true;
+}
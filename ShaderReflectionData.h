@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Platform-independent copy of everything SimpleShader
+// pulls out of D3DReflect.  Enum-valued fields hold the raw
+// D3D values (D3D_SHADER_INPUT_TYPE, D3D_REGISTER_COMPONENT_TYPE)
+// so this file needs no Windows headers.
+// --------------------------------------------------------
+struct ShaderReflectionVariable
+{
+	std::string Name;
+	uint32_t ByteOffset;
+	uint32_t Size;
+};
+
+struct ShaderReflectionBuffer
+{
+	std::string Name;
+	uint32_t Size;
+	uint32_t BindIndex;
+	std::vector<ShaderReflectionVariable> Variables;
+};
+
+struct ShaderReflectionResource
+{
+	std::string Name;
+	uint32_t Type;		// D3D_SHADER_INPUT_TYPE
+	uint32_t BindIndex;
+};
+
+struct ShaderReflectionParameter
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex;
+	uint32_t Register;
+	uint32_t ComponentType; // D3D_REGISTER_COMPONENT_TYPE
+	uint32_t Mask;
+	uint32_t Stream;
+};
+
+struct ShaderReflectionData
+{
+	std::vector<ShaderReflectionBuffer> ConstantBuffers;
+	std::vector<ShaderReflectionResource> Resources;
+	std::vector<ShaderReflectionParameter> InputParameters;
+	std::vector<ShaderReflectionParameter> OutputParameters;
+	uint32_t ThreadsX = 0;
+	uint32_t ThreadsY = 0;
+	uint32_t ThreadsZ = 0;
+
+	void Clear();
+};
+
+// --------------------------------------------------------
+// Binary (de)serialization of reflection data, used for the
+// on-disk cache that sits next to each compiled shader.
+//
+// The format is little-endian regardless of host, and
+// every cache is stamped with a hash of the shader bytecode
+// it describes, so a recompiled shader invalidates it.
+// --------------------------------------------------------
+class ShaderReflectionSerializer
+{
+public:
+	// FNV-1a over arbitrary bytes (used on the .cso contents)
+	static uint64_t HashBytes(const void* data, size_t size);
+
+	static void Serialize(const ShaderReflectionData& data, uint64_t contentHash, std::vector<unsigned char>& out);
+
+	// Returns false if the bytes are truncated, from another
+	// format version or describe a different shader
+	static bool Deserialize(const unsigned char* bytes, size_t size, uint64_t expectedHash, ShaderReflectionData& out);
+};
@@ -4,11 +4,15 @@
 // ------ BASE SIMPLE SHADER --------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
 
+unsigned int ISimpleShader::nextId = 0;
+
 // --------------------------------------------------------
 // Constructor accepts DirectX device & context
 // --------------------------------------------------------
 ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 {
+	this->id = nextId++;
+
 	// Save the device
 	this->device = device;
 	this->deviceContext = context;
@@ -56,10 +60,10 @@ void ISimpleShader::CleanUp()
 		delete samplerStates[i];
 
 	// Clean up tables
-	varTable.clear();
-	cbTable.clear();
-	samplerTable.clear();
-	textureTable.clear();
+	varTable.Clear();
+	cbTable.Clear();
+	samplerTable.Clear();
+	textureTable.Clear();
 }
 
 // --------------------------------------------------------
@@ -71,14 +75,80 @@ void ISimpleShader::CleanUp()
 // Returns true if shader is loaded properly, false otherwise
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
+{
+	ID3DBlob* blob = 0;
+	ShaderReflectionData data;
+	if (!ReadShaderFile(shaderFile, &blob, data))
+		return false;
+
+	bool result = LoadShaderBlob(blob, data);
+	blob->Release();
+	return result;
+}
+
+// --------------------------------------------------------
+// Reads a compiled shader and its reflection data from disk
+// without touching the device, so this is safe to call from
+// any thread.  Reflection results are cached next to the
+// compiled shader, in "<shader>.cso.refl" (the full .cso name
+// plus ".refl"), so later runs can skip D3DReflect entirely.
+//
+// shaderFile - A "wide string" specifying the compiled shader to load
+// blob       - Receives the shader code (caller must Release it)
+// reflection - Receives the reflection data
+// 
+// Returns true if the shader was read and reflected
+// --------------------------------------------------------
+bool ISimpleShader::ReadShaderFile(LPCWSTR shaderFile, ID3DBlob** blob, ShaderReflectionData& reflection)
 {
 	// Load the shader to a blob and ensure it worked
-	HRESULT hr = D3DReadFileToBlob(shaderFile, &shaderBlob);
+	HRESULT hr = D3DReadFileToBlob(shaderFile, blob);
 	if (hr != S_OK)
 	{
 		return false;
 	}
 
+	// Grab the reflection data, either from the cache (if it
+	// still matches this exact bytecode) or the shader itself
+	uint64_t contentHash = ShaderReflectionSerializer::HashBytes(
+		(*blob)->GetBufferPointer(),
+		(*blob)->GetBufferSize());
+
+	std::wstring cacheFile = std::wstring(shaderFile) + L".refl";
+	if (!ReadReflectionCache(cacheFile.c_str(), contentHash, reflection))
+	{
+		if (!ReflectShaderBlob(*blob, reflection))
+		{
+			(*blob)->Release();
+			*blob = 0;
+			return false;
+		}
+
+		// Failing to write the cache just means we reflect next time too
+		WriteReflectionCache(cacheFile.c_str(), contentHash, reflection);
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Creates the shader and builds the variable table from
+// already-loaded shader code and reflection data
+//
+// blob       - The compiled shader code (this shader keeps a reference)
+// reflection - Reflection data for this exact shader code
+// 
+// Returns true if shader is created properly, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::LoadShaderBlob(ID3DBlob* blob, const ShaderReflectionData& reflection)
+{
+	// Hang on to the shader code and its description
+	if (shaderBlob)
+		shaderBlob->Release();
+	shaderBlob = blob;
+	shaderBlob->AddRef();
+	this->reflection = reflection;
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -87,42 +157,26 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
+	constantBufferCount = (unsigned int)reflection.ConstantBuffers.size();
 	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
 	
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (const ShaderReflectionResource& resource : reflection.Resources)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
 		// Check the type
-		switch (resourceDesc.Type)
+		switch (resource.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
+		case D3D_SIT_STRUCTURED: // Read-only buffers are bound as SRVs too
+		case D3D_SIT_BYTEADDRESS:
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
+			srv->BindIndex = resource.BindIndex;					// Shader bind point
 			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			textureTable.Insert(resource.Name, srv);
 			shaderResourceViews.push_back(srv);
 		}
 			break;
@@ -131,10 +185,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		{
 			// Create the sampler wrapper
 			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
+			samp->BindIndex = resource.BindIndex;				// Shader bind point
 			samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			samplerTable.Insert(resource.Name, samp);
 			samplerStates.push_back(samp);
 		}
 			break;
@@ -144,23 +198,12 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	// Loop through all constant buffers
 	for (unsigned int b = 0; b < constantBufferCount; b++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
-		
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+		const ShaderReflectionBuffer& bufferDesc = reflection.ConstantBuffers[b];
 		
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
+		constantBuffers[b].BindIndex = bufferDesc.BindIndex;
 		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		cbTable.Insert(bufferDesc.Name, &constantBuffers[b]);
 
 		// Create this constant buffer
 		D3D11_BUFFER_DESC newBuffDesc;
@@ -178,36 +221,208 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
 
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (const ShaderReflectionVariable& varDesc : bufferDesc.Variables)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
-
 			// Create the variable struct
 			SimpleShaderVariable varStruct;
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
+			varStruct.ByteOffset = varDesc.ByteOffset;
 			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
 
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varTable.Insert(varDesc.Name, varStruct);
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
 
 	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Fills in reflection data from the shader bytecode
+// using D3DReflect
+//
+// Returns false if the blob could not be reflected
+// --------------------------------------------------------
+bool ISimpleShader::ReflectShaderBlob(ID3DBlob* shaderBlob, ShaderReflectionData& reflection)
+{
+	reflection.Clear();
+
+	// Set up shader reflection to get information about
+	// this shader and its variables,  buffers, etc.
+	ID3D11ShaderReflection* refl;
+	HRESULT hr = D3DReflect(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		IID_ID3D11ShaderReflection,
+		(void**)&refl);
+	if (FAILED(hr))
+		return false;
+	
+	// Get the description of the shader
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	// Bound resources (textures, samplers, UAVs, etc.)
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+
+		ShaderReflectionResource resource;
+		resource.Name = resourceDesc.Name;
+		resource.Type = resourceDesc.Type;
+		resource.BindIndex = resourceDesc.BindPoint;
+		reflection.Resources.push_back(resource);
+	}
+
+	// Constant buffers and their variables
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb =
+			refl->GetConstantBufferByIndex(b);
+		
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+		
+		// Get the description of the resource binding, so
+		// we know exactly how it's bound in the shader
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ShaderReflectionBuffer buffer;
+		buffer.Name = bufferDesc.Name;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindIndex = bindDesc.BindPoint;
+
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			ID3D11ShaderReflectionVariable* var =
+				cb->GetVariableByIndex(v);
+			
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			var->GetDesc(&varDesc);
+
+			ShaderReflectionVariable variable;
+			variable.Name = varDesc.Name;
+			variable.ByteOffset = varDesc.StartOffset;
+			variable.Size = varDesc.Size;
+			buffer.Variables.push_back(variable);
+		}
+
+		reflection.ConstantBuffers.push_back(buffer);
+	}
+
+	// Input and output signatures (for input layouts and stream out)
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+
+		ShaderReflectionParameter param;
+		param.SemanticName = paramDesc.SemanticName;
+		param.SemanticIndex = paramDesc.SemanticIndex;
+		param.Register = paramDesc.Register;
+		param.ComponentType = paramDesc.ComponentType;
+		param.Mask = paramDesc.Mask;
+		param.Stream = paramDesc.Stream;
+		reflection.InputParameters.push_back(param);
+	}
+
+	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetOutputParameterDesc(i, &paramDesc);
+
+		ShaderReflectionParameter param;
+		param.SemanticName = paramDesc.SemanticName;
+		param.SemanticIndex = paramDesc.SemanticIndex;
+		param.Register = paramDesc.Register;
+		param.ComponentType = paramDesc.ComponentType;
+		param.Mask = paramDesc.Mask;
+		param.Stream = paramDesc.Stream;
+		reflection.OutputParameters.push_back(param);
+	}
+
+	// Thread group size (only meaningful for compute shaders)
+	refl->GetThreadGroupSize(
+		&reflection.ThreadsX,
+		&reflection.ThreadsY,
+		&reflection.ThreadsZ);
+
 	refl->Release();
 	return true;
 }
 
+// --------------------------------------------------------
+// Attempts to fill in reflection data from a cache file,
+// which is memory mapped rather than read into a copy
+//
+// cacheFile   - Path to the ".refl" file
+// contentHash - Hash of the shader bytecode the cache must match
+//
+// Returns false if the cache is missing, stale or corrupt
+// --------------------------------------------------------
+bool ISimpleShader::ReadReflectionCache(LPCWSTR cacheFile, uint64_t contentHash, ShaderReflectionData& reflection)
+{
+	HANDLE file = CreateFileW(cacheFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool result = false;
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && fileSize.HighPart == 0)
+	{
+		HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping)
+		{
+			const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view)
+			{
+				result = ShaderReflectionSerializer::Deserialize(
+					(const unsigned char*)view,
+					(size_t)fileSize.QuadPart,
+					contentHash,
+					reflection);
+				UnmapViewOfFile(view);
+			}
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+	return result;
+}
+
+// --------------------------------------------------------
+// Saves reflection data to a cache file
+//
+// Returns true if the whole file was written
+// --------------------------------------------------------
+bool ISimpleShader::WriteReflectionCache(LPCWSTR cacheFile, uint64_t contentHash, const ShaderReflectionData& reflection)
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionSerializer::Serialize(reflection, contentHash, bytes);
+
+	HANDLE file = CreateFileW(cacheFile, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	BOOL ok = WriteFile(file, &bytes[0], (DWORD)bytes.size(), &written, 0);
+	CloseHandle(file);
+
+	// Don't leave a partial file behind to be rejected every launch
+	if (!ok || written != bytes.size())
+	{
+		DeleteFileW(cacheFile);
+		return false;
+	}
+
+	return true;
+}
+
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
 // verifying that it is the requested size
@@ -215,19 +430,15 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(std::string_view name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+	SimpleShaderVariable* var = varTable.Find(name);
 
 	// Did we find the key?
-	if (result == varTable.end())
+	if (var == 0)
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
-
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
 		return 0;
@@ -239,18 +450,17 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
+	SimpleConstantBuffer** result = cbTable.Find(name);
 
 	// Did we find the key?
-	if (result == cbTable.end())
+	if (result == 0)
 		return 0;
 
 	// Success
-	return result->second;
+	return *result;
 }
 
 // --------------------------------------------------------
@@ -323,7 +533,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(std::string_view bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -339,6 +549,78 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 }
 
 
+// --------------------------------------------------------
+// Copies an entire C++ struct into a constant buffer's local
+// data, validating the struct's layout on first use
+//
+// cb         - The constant buffer to fill
+// data       - The struct to copy
+// size       - sizeof() the struct
+// typeHash   - A hash identifying the struct's type
+// fields     - Description of the struct's members
+// fieldCount - Number of entries in fields
+//
+// Returns true if data is copied, false if the buffer doesn't
+// exist or the struct doesn't match its layout
+// --------------------------------------------------------
+bool ISimpleShader::SetStructData(SimpleConstantBuffer* cb, const void* data, size_t size, size_t typeHash, const SimpleShaderStructField* fields, unsigned int fieldCount)
+{
+	if (!ValidateStructLayout(cb, size, typeHash, fields, fieldCount))
+		return false;
+
+	memcpy(cb->LocalDataBuffer, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Checks that a C++ struct exactly describes a constant
+// buffer: every shader variable has a member with the same
+// name, offset and size (and vice versa), and the struct
+// fits within the buffer.  Successful checks are remembered
+// per buffer so later calls with the same type are free.
+//
+// Returns true if the struct matches the buffer
+// --------------------------------------------------------
+bool ISimpleShader::ValidateStructLayout(SimpleConstantBuffer* cb, size_t size, size_t typeHash, const SimpleShaderStructField* fields, unsigned int fieldCount)
+{
+	if (!cb)
+		return false;
+
+	// Already checked this type?
+	if (cb->StructTypeHash == typeHash)
+		return true;
+
+	if (size > cb->Size)
+		return false;
+
+	// Reflection still has the variable names for this buffer
+	const ShaderReflectionBuffer& bufferDesc = reflection.ConstantBuffers[cb - constantBuffers];
+	if (bufferDesc.Variables.size() != fieldCount)
+		return false;
+
+	for (const ShaderReflectionVariable& var : bufferDesc.Variables)
+	{
+		bool matched = false;
+		for (unsigned int f = 0; f < fieldCount; f++)
+		{
+			if (var.Name == fields[f].Name)
+			{
+				matched =
+					var.ByteOffset == fields[f].ByteOffset &&
+					var.Size == fields[f].Size;
+				break;
+			}
+		}
+
+		if (!matched)
+			return false;
+	}
+
+	cb->StructTypeHash = typeHash;
+	return true;
+}
+
+
 // --------------------------------------------------------
 // Sets a variable by name with arbitrary data of the specified size
 //
@@ -348,7 +630,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(std::string_view name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, -1);
@@ -373,7 +655,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(std::string_view name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -381,7 +663,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(std::string_view name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -389,7 +671,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(std::string_view name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -397,7 +679,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(std::string_view name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -405,7 +687,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(std::string_view name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -413,7 +695,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(std::string_view name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -421,7 +703,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(std::string_view name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -429,7 +711,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(std::string_view name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -437,7 +719,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(std::string_view name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -445,7 +727,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(std::string_view name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
@@ -453,7 +735,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string_view name)
 {
 	return FindVariable(name, -1);
 }
@@ -463,18 +745,17 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+	SimpleSRV** result = textureTable.Find(name);
 
 	// Did we find the key?
-	if (result == textureTable.end())
+	if (result == 0)
 		return 0;
 
 	// Success
-	return result->second;
+	return *result;
 }
 
 
@@ -498,18 +779,17 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+	SimpleSampler** result = samplerTable.Find(name);
 
 	// Did we find the key?
-	if (result == samplerTable.end())
+	if (result == 0)
 		return 0;
 
 	// Success
-	return result->second;
+	return *result;
 }
 
 // --------------------------------------------------------
@@ -551,7 +831,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string_view name)
 {
 	return FindConstantBuffer(name);
 }
@@ -570,6 +850,180 @@ const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(unsigned int index)
 	return &constantBuffers[index];
 }
 
+// --------------------------------------------------------
+// Binds any SRVs and samplers staged on this shader's stage
+// since the last flush (by any shader on that stage)
+// --------------------------------------------------------
+void ISimpleShader::FlushResources()
+{
+	stageBindings[(int)GetStage()].Flush(deviceContext, GetStage());
+}
+
+// --------------------------------------------------------
+// Forgets what's bound on every stage
+// --------------------------------------------------------
+void ISimpleShader::InvalidateBoundResources()
+{
+	for (SimpleShaderStageBindings& bindings : stageBindings)
+		bindings.Invalidate();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ SIMPLE SHADER STAGE BINDINGS ----------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+SimpleShaderStageBindings ISimpleShader::stageBindings[(int)SimpleShaderStage::Count];
+
+SimpleShaderStageBindings::SimpleShaderStageBindings()
+{
+	context = 0;
+
+	for (unsigned int i = 0; i < SRVSlots; i++)
+	{
+		srvs[i] = 0;
+		boundSRVs[i] = 0;
+		srvKnown[i] = false;
+	}
+
+	for (unsigned int i = 0; i < SamplerSlots; i++)
+	{
+		samplers[i] = 0;
+		boundSamplers[i] = 0;
+		samplerKnown[i] = false;
+	}
+
+	srvDirtyStart = srvDirtyEnd = 0;
+	samplerDirtyStart = samplerDirtyEnd = 0;
+}
+
+// --------------------------------------------------------
+// Records an SRV for a slot, marking the slot for binding
+// unless it already holds that SRV
+// --------------------------------------------------------
+void SimpleShaderStageBindings::StageShaderResource(unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	if (slot >= SRVSlots)
+		return;
+
+	srvs[slot] = srv;
+	if (srvKnown[slot] && boundSRVs[slot] == srv)
+		return;
+
+	if (srvDirtyStart == srvDirtyEnd)
+	{
+		srvDirtyStart = slot;
+		srvDirtyEnd = slot + 1;
+	}
+	else
+	{
+		srvDirtyStart = (std::min)(srvDirtyStart, slot);
+		srvDirtyEnd = (std::max)(srvDirtyEnd, slot + 1);
+	}
+}
+
+// --------------------------------------------------------
+// Records a sampler for a slot, marking the slot for
+// binding unless it already holds that sampler
+// --------------------------------------------------------
+void SimpleShaderStageBindings::StageSampler(unsigned int slot, ID3D11SamplerState* samplerState)
+{
+	if (slot >= SamplerSlots)
+		return;
+
+	samplers[slot] = samplerState;
+	if (samplerKnown[slot] && boundSamplers[slot] == samplerState)
+		return;
+
+	if (samplerDirtyStart == samplerDirtyEnd)
+	{
+		samplerDirtyStart = slot;
+		samplerDirtyEnd = slot + 1;
+	}
+	else
+	{
+		samplerDirtyStart = (std::min)(samplerDirtyStart, slot);
+		samplerDirtyEnd = (std::max)(samplerDirtyEnd, slot + 1);
+	}
+}
+
+// --------------------------------------------------------
+// Binds the changed range of SRVs and of samplers.  Slots
+// in the middle of a range that didn't change are bound
+// again too, which is harmless and keeps it to one call each
+// --------------------------------------------------------
+void SimpleShaderStageBindings::Flush(ID3D11DeviceContext* context, SimpleShaderStage stage)
+{
+	// We know nothing about what's bound on another context
+	if (this->context != context)
+	{
+		Invalidate();
+		this->context = context;
+
+		// So bind every slot once
+		srvDirtyStart = 0;
+		srvDirtyEnd = SRVSlots;
+		samplerDirtyStart = 0;
+		samplerDirtyEnd = SamplerSlots;
+	}
+
+	if (srvDirtyStart != srvDirtyEnd)
+	{
+		unsigned int count = srvDirtyEnd - srvDirtyStart;
+		ID3D11ShaderResourceView* const* first = &srvs[srvDirtyStart];
+		switch (stage)
+		{
+		case SimpleShaderStage::Vertex:		context->VSSetShaderResources(srvDirtyStart, count, first); break;
+		case SimpleShaderStage::Hull:		context->HSSetShaderResources(srvDirtyStart, count, first); break;
+		case SimpleShaderStage::Domain:		context->DSSetShaderResources(srvDirtyStart, count, first); break;
+		case SimpleShaderStage::Geometry:	context->GSSetShaderResources(srvDirtyStart, count, first); break;
+		case SimpleShaderStage::Pixel:		context->PSSetShaderResources(srvDirtyStart, count, first); break;
+		case SimpleShaderStage::Compute:	context->CSSetShaderResources(srvDirtyStart, count, first); break;
+		default: break;
+		}
+
+		for (unsigned int i = srvDirtyStart; i < srvDirtyEnd; i++)
+		{
+			boundSRVs[i] = srvs[i];
+			srvKnown[i] = true;
+		}
+		srvDirtyStart = srvDirtyEnd = 0;
+	}
+
+	if (samplerDirtyStart != samplerDirtyEnd)
+	{
+		unsigned int count = samplerDirtyEnd - samplerDirtyStart;
+		ID3D11SamplerState* const* first = &samplers[samplerDirtyStart];
+		switch (stage)
+		{
+		case SimpleShaderStage::Vertex:		context->VSSetSamplers(samplerDirtyStart, count, first); break;
+		case SimpleShaderStage::Hull:		context->HSSetSamplers(samplerDirtyStart, count, first); break;
+		case SimpleShaderStage::Domain:		context->DSSetSamplers(samplerDirtyStart, count, first); break;
+		case SimpleShaderStage::Geometry:	context->GSSetSamplers(samplerDirtyStart, count, first); break;
+		case SimpleShaderStage::Pixel:		context->PSSetSamplers(samplerDirtyStart, count, first); break;
+		case SimpleShaderStage::Compute:	context->CSSetSamplers(samplerDirtyStart, count, first); break;
+		default: break;
+		}
+
+		for (unsigned int i = samplerDirtyStart; i < samplerDirtyEnd; i++)
+		{
+			boundSamplers[i] = samplers[i];
+			samplerKnown[i] = true;
+		}
+		samplerDirtyStart = samplerDirtyEnd = 0;
+	}
+}
+
+void SimpleShaderStageBindings::Invalidate()
+{
+	for (unsigned int i = 0; i < SRVSlots; i++)
+		srvKnown[i] = false;
+
+	for (unsigned int i = 0; i < SamplerSlots; i++)
+		samplerKnown[i] = false;
+}
+
 
 
 
@@ -578,6 +1032,11 @@ const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(unsigned int index)
 // ------ SIMPLE VERTEX SHADER ------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
 
+// Static input layout cache and bound state
+std::unordered_multimap<size_t, SimpleVertexShader::InputLayoutCacheEntry> SimpleVertexShader::inputLayoutCache;
+ID3D11DeviceContext* SimpleVertexShader::boundContext = 0;
+ID3D11InputLayout* SimpleVertexShader::boundInputLayout = 0;
+
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
@@ -614,6 +1073,20 @@ SimpleVertexShader::SimpleVertexShader(ID3D11Device * device, ID3D11DeviceContex
 	this->LoadShaderFile(shaderFile);
 }
 
+// --------------------------------------------------------
+// Constructor overload which takes shader code that was
+// already loaded (see ISimpleShader::ReadShaderFile())
+// --------------------------------------------------------
+SimpleVertexShader::SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
+	: ISimpleShader(device, context)
+{
+	this->inputLayout = 0;
+	this->shader = 0;
+	this->perInstanceCompatible = false;
+
+	this->LoadShaderBlob(shaderBlob, reflection);
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up actual shader (base will be called automatically)
 // --------------------------------------------------------
@@ -629,7 +1102,41 @@ void SimpleVertexShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
 	if (shader) { shader->Release(); shader = 0; }
-	if (inputLayout) { inputLayout->Release(); inputLayout = 0; }
+	if (inputLayout)
+	{
+		// Don't let a stale pointer match a future layout
+		if (inputLayout == boundInputLayout)
+			ResetBoundInputLayout();
+
+		inputLayout->Release();
+		inputLayout = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Releases the cache's references to all shared input
+// layouts.  Shaders still using a layout keep their own
+// reference, so this is safe to call at any time (usually
+// at shutdown, before the device goes away)
+// --------------------------------------------------------
+void SimpleVertexShader::ReleaseInputLayoutCache()
+{
+	for (auto& entry : inputLayoutCache)
+		entry.second.InputLayout->Release();
+
+	inputLayoutCache.clear();
+	ResetBoundInputLayout();
+}
+
+// --------------------------------------------------------
+// Forgets which input layout is currently bound.  Call this
+// if the input layout is changed outside of SimpleShader
+// (IASetInputLayout, ClearState, etc.)
+// --------------------------------------------------------
+void SimpleVertexShader::ResetBoundInputLayout()
+{
+	boundContext = 0;
+	boundInputLayout = 0;
 }
 
 // --------------------------------------------------------
@@ -662,32 +1169,18 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
+	// reflected input signature to create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Read input layout description from shader info
+	// Read input layout description from the reflected input signature
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	std::string signature;
+	for (const ShaderReflectionParameter& paramDesc : reflection.InputParameters)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
-
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.SemanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -695,7 +1188,7 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc;
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -740,6 +1233,33 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 
 		// Save element desc
 		inputLayoutDesc.push_back(elementDesc);
+
+		// Append this element to the layout's signature, which
+		// is what identical vertex shader inputs will share
+		signature += elementDesc.SemanticName;
+		signature += '|';
+		signature += std::to_string(elementDesc.SemanticIndex) + ',';
+		signature += std::to_string(elementDesc.Format) + ',';
+		signature += std::to_string(elementDesc.InputSlot) + ',';
+		signature += std::to_string(elementDesc.InputSlotClass) + ',';
+		signature += std::to_string(paramDesc.Register) + ';';
+	}
+
+	// Nothing to describe (vertices generated from SV_VertexID, etc.)
+	if (inputLayoutDesc.empty())
+		return true;
+
+	// Look for an existing layout with the same signature
+	size_t hash = std::hash<std::string>()(signature);
+	auto range = inputLayoutCache.equal_range(hash);
+	for (auto it = range.first; it != range.second; it++)
+	{
+		if (it->second.Device == device && it->second.Signature == signature)
+		{
+			inputLayout = it->second.InputLayout;
+			inputLayout->AddRef();
+			return true;
+		}
 	}
 
 	// Try to create Input Layout
@@ -750,8 +1270,15 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		shaderBlob->GetBufferSize(),
 		&inputLayout);
 
-	// All done, clean up
-	refl->Release();
+	// Share it with any future shader using the same signature
+	// (the cache holds its own reference)
+	if (SUCCEEDED(hr))
+	{
+		InputLayoutCacheEntry entry = { device, signature, inputLayout };
+		inputLayout->AddRef();
+		inputLayoutCache.insert(std::pair<size_t, InputLayoutCacheEntry>(hash, entry));
+	}
+
 	return true;
 }
 
@@ -764,8 +1291,16 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
-	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout);
+	// Set the input layout, skipping the call if another
+	// shader already bound this same (shared) layout
+	if (boundContext != deviceContext || boundInputLayout != inputLayout)
+	{
+		deviceContext->IASetInputLayout(inputLayout);
+		boundContext = deviceContext;
+		boundInputLayout = inputLayout;
+	}
+
+	// Set the shader
 	deviceContext->VSSetShader(shader, 0, 0);
 
 	// Set the constant buffers
@@ -779,44 +1314,44 @@ void SimpleVertexShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the vertex shader stage
+// Stages a shader resource view for the vertex shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleVertexShader::SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
 	if (srvInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	// Stage the shader resource view (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Vertex].StageShaderResource(srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the vertex shader stage
+// Stages a sampler state for the vertex shader stage
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleVertexShader::SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Stage the sampler state (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Vertex].StageSampler(sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -839,6 +1374,18 @@ SimplePixelShader::SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext*
 	this->LoadShaderFile(shaderFile);
 }
 
+// --------------------------------------------------------
+// Constructor overload which takes shader code that was
+// already loaded (see ISimpleShader::ReadShaderFile())
+// --------------------------------------------------------
+SimplePixelShader::SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
+	: ISimpleShader(device, context)
+{
+	this->shader = 0;
+
+	this->LoadShaderBlob(shaderBlob, reflection);
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up actual shader (base will be called automatically)
 // --------------------------------------------------------
@@ -903,44 +1450,44 @@ void SimplePixelShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the pixel shader stage
+// Stages a shader resource view for the pixel shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimplePixelShader::SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
 	if (srvInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	// Stage the shader resource view (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Pixel].StageShaderResource(srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the pixel shader stage
+// Stages a sampler state for the pixel shader stage
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimplePixelShader::SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Stage the sampler state (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Pixel].StageSampler(sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1029,44 +1576,44 @@ void SimpleDomainShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the domain shader stage
+// Stages a shader resource view for the domain shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleDomainShader::SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
 	if (srvInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	// Stage the shader resource view (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Domain].StageShaderResource(srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the domain shader stage
+// Stages a sampler state for the domain shader stage
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleDomainShader::SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Stage the sampler state (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Domain].StageSampler(sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1154,44 +1701,44 @@ void SimpleHullShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the hull shader stage
+// Stages a shader resource view for the hull shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleHullShader::SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
 	if (srvInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	// Stage the shader resource view (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Hull].StageShaderResource(srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the hull shader stage
+// Stages a sampler state for the hull shader stage
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleHullShader::SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Stage the sampler state (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Hull].StageSampler(sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1278,31 +1825,15 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* shaderBlob)
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Set up the output signature
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (const ShaderReflectionParameter& paramDesc : reflection.OutputParameters)
 	{
-		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
-		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry;
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
+		entry.SemanticName   = paramDesc.SemanticName.c_str();
 		entry.Stream         = paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
@@ -1402,44 +1933,44 @@ void SimpleGeometryShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Geometry shader stage
+// Stages a shader resource view for the Geometry shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleGeometryShader::SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
 	if (srvInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	// Stage the shader resource view (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Geometry].StageShaderResource(srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Geometry shader stage
+// Stages a sampler state for the Geometry shader stage
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleGeometryShader::SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Stage the sampler state (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Geometry].StageSampler(sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1484,6 +2015,22 @@ SimpleComputeShader::SimpleComputeShader(ID3D11Device* device, ID3D11DeviceConte
 	this->LoadShaderFile(shaderFile);
 }
 
+// --------------------------------------------------------
+// Constructor overload which takes shader code that was
+// already loaded (see ISimpleShader::ReadShaderFile())
+// --------------------------------------------------------
+SimpleComputeShader::SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
+	: ISimpleShader(device, context)
+{
+	this->threadsTotal = 0;
+	this->threadsX = 0;
+	this->threadsY = 0;
+	this->threadsZ = 0;
+	this->shader = 0;
+
+	this->LoadShaderBlob(shaderBlob, reflection);
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up actual shader (base will be called automatically)
 // --------------------------------------------------------
@@ -1500,7 +2047,7 @@ void SimpleComputeShader::CleanUp()
 	ISimpleShader::CleanUp();
 	if (shader) { shader->Release(); shader = 0; }
 
-	uavTable.clear();
+	uavTable.Clear();
 }
 
 // --------------------------------------------------------
@@ -1527,34 +2074,17 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
+	threadsX = reflection.ThreadsX;
+	threadsY = reflection.ThreadsY;
+	threadsZ = reflection.ThreadsZ;
+	threadsTotal = threadsX * threadsY * threadsZ;
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (const ShaderReflectionResource& resource : reflection.Resources)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
 		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
+		switch (resource.Type)
 		{
 		case D3D_SIT_UAV_APPEND_STRUCTURED:
 		case D3D_SIT_UAV_CONSUME_STRUCTURED:
@@ -1562,12 +2092,11 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 		case D3D_SIT_UAV_RWSTRUCTURED:
 		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
 		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
+			uavTable.Insert(resource.Name, resource.BindIndex);
 		}
 	}
 
 	// All set
-	refl->Release();
 	return true;
 }
 
@@ -1615,6 +2144,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
 {
+	FlushResources();
 	deviceContext->Dispatch(groupsX, groupsY, groupsZ);
 }
 
@@ -1640,6 +2170,7 @@ void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int gr
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ)
 {
+	FlushResources();
 	deviceContext->Dispatch(
 		max((unsigned int)ceil((float)threadsX / this->threadsX), 1),
 		max((unsigned int)ceil((float)threadsY / this->threadsY), 1),
@@ -1647,44 +2178,44 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Compute shader stage
+// Stages a shader resource view for the Compute shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleComputeShader::SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
 	if (srvInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	// Stage the shader resource view (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Compute].StageShaderResource(srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Compute shader stage
+// Stages a sampler state for the Compute shader stage
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleComputeShader::SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Stage the sampler state (bound by FlushResources())
+	stageBindings[(int)SimpleShaderStage::Compute].StageSampler(sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1699,7 +2230,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState*
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView * uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(std::string_view name, ID3D11UnorderedAccessView * uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1716,16 +2247,15 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11Unorder
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
-		uavTable.find(name);
+	unsigned int* result = uavTable.Find(name);
 
 	// Did we find the key?
-	if (result == uavTable.end())
+	if (result == 0)
 		return -1;
 
 	// Success
-	return result->second;
+	return *result;
 }
\ No newline at end of file
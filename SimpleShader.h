@@ -9,6 +9,13 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <typeinfo>
+
+#include "ShaderReflectionData.h"
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -34,6 +41,62 @@ struct SimpleConstantBuffer
 	ID3D11Buffer* ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+	size_t StructTypeHash = 0; // C++ struct validated by SetStruct(), if any
+};
+
+// --------------------------------------------------------
+// Describes one member of a C++ struct that mirrors a
+// constant buffer, so SetStruct() can validate its layout.
+// Structs expose these through a static GetShaderFields()
+// --------------------------------------------------------
+struct SimpleShaderStructField
+{
+	const char* Name;
+	unsigned int ByteOffset;
+	unsigned int Size;
+};
+
+#define SIMPLE_SHADER_FIELD(type, member) \
+	{ #member, (unsigned int)offsetof(type, member), (unsigned int)sizeof(((type*)0)->member) }
+
+// --------------------------------------------------------
+// Name -> value table for a shader's variables and resources.
+// Names are copied in once at load time; lookups take a
+// string_view and binary search the sorted entries, so
+// setting data by name never allocates
+// --------------------------------------------------------
+template<typename T>
+class SimpleShaderNameTable
+{
+public:
+	// Keeps the first value if a name is inserted twice
+	void Insert(std::string_view name, const T& value)
+	{
+		auto it = LowerBound(name);
+		if (it != entries.end() && it->first == name)
+			return;
+		entries.insert(it, std::make_pair(std::string(name), value));
+	}
+
+	T* Find(std::string_view name)
+	{
+		auto it = LowerBound(name);
+		if (it == entries.end() || it->first != name)
+			return 0;
+		return &it->second;
+	}
+
+	size_t Size() const { return entries.size(); }
+	void Clear() { entries.clear(); }
+
+private:
+	std::vector<std::pair<std::string, T>> entries;
+
+	typename std::vector<std::pair<std::string, T>>::iterator LowerBound(std::string_view name)
+	{
+		return std::lower_bound(entries.begin(), entries.end(), name,
+			[](const std::pair<std::string, T>& entry, std::string_view key) { return std::string_view(entry.first) < key; });
+	}
 };
 
 // --------------------------------------------------------
@@ -54,6 +117,53 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// Pipeline stages, for tracking what's bound on each
+// --------------------------------------------------------
+enum class SimpleShaderStage { Vertex, Hull, Domain, Geometry, Pixel, Compute, Count };
+
+// --------------------------------------------------------
+// The SRVs and samplers staged for one pipeline stage.
+// Shaders' setters only record into these slots; Flush()
+// then binds all changed SRVs with one call and all changed
+// samplers with another, skipping slots that already hold
+// the same resource
+// --------------------------------------------------------
+class SimpleShaderStageBindings
+{
+public:
+	SimpleShaderStageBindings();
+
+	void StageShaderResource(unsigned int slot, ID3D11ShaderResourceView* srv);
+	void StageSampler(unsigned int slot, ID3D11SamplerState* samplerState);
+	void Flush(ID3D11DeviceContext* context, SimpleShaderStage stage);
+
+	// Forget what's bound, so the next time each slot is
+	// staged it's bound even if it looks unchanged
+	void Invalidate();
+
+private:
+	static const unsigned int SRVSlots = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+	static const unsigned int SamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+
+	ID3D11DeviceContext* context;
+
+	// Staged resources, what's actually bound, and whether
+	// we know what's bound (false until we've bound the slot)
+	ID3D11ShaderResourceView* srvs[SRVSlots];
+	ID3D11ShaderResourceView* boundSRVs[SRVSlots];
+	bool srvKnown[SRVSlots];
+	ID3D11SamplerState* samplers[SamplerSlots];
+	ID3D11SamplerState* boundSamplers[SamplerSlots];
+	bool samplerKnown[SamplerSlots];
+
+	// Range of changed slots [start, end) to bind on Flush()
+	unsigned int srvDirtyStart;
+	unsigned int srvDirtyEnd;
+	unsigned int samplerDirtyStart;
+	unsigned int samplerDirtyEnd;
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -65,53 +175,89 @@ public:
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
+	unsigned int GetId() { return id; } // Unique per shader object
 
 	// Activating the shader and copying data
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(std::string_view bufferName);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
-
-	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	bool SetData(std::string_view name, const void* data, unsigned int size);
+
+	bool SetInt(std::string_view name, int data);
+	bool SetFloat(std::string_view name, float data);
+	bool SetFloat2(std::string_view name, const float data[2]);
+	bool SetFloat2(std::string_view name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(std::string_view name, const float data[3]);
+	bool SetFloat3(std::string_view name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(std::string_view name, const float data[4]);
+	bool SetFloat4(std::string_view name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(std::string_view name, const float data[16]);
+	bool SetMatrix4x4(std::string_view name, const DirectX::XMFLOAT4X4 data);
+
+	// Copies a whole C++ struct into a constant buffer.  The struct's
+	// layout is checked against reflection the first time, after
+	// which this is a single lookup and memcpy
+	template<typename T>
+	bool SetStruct(std::string_view bufferName, const T& data)
+	{
+		unsigned int fieldCount = 0;
+		const SimpleShaderStructField* fields = T::GetShaderFields(&fieldCount);
+		return SetStructData(FindConstantBuffer(bufferName), &data, sizeof(T), typeid(T).hash_code(), fields, fieldCount);
+	}
+
+	// Checks (without copying anything) that a C++ struct
+	// matches a constant buffer's layout
+	template<typename T>
+	bool ValidateStruct(std::string_view bufferName)
+	{
+		unsigned int fieldCount = 0;
+		const SimpleShaderStructField* fields = T::GetShaderFields(&fieldCount);
+		return ValidateStructLayout(FindConstantBuffer(bufferName), sizeof(T), typeid(T).hash_code(), fields, fieldCount);
+	}
+
+	// Setting shader resources.  These are staged and only
+	// bound by FlushResources(), so call that before drawing
+	virtual bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv) = 0;
+	virtual bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState) = 0;
+	void FlushResources();
+
+	// Call after binding SRVs or samplers without going through
+	// SimpleShader (or after the runtime unbinds an SRV because
+	// its resource was bound for output)
+	static void InvalidateBoundResources();
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(std::string_view name);
 	
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(std::string_view name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	size_t GetShaderResourceViewCount() { return textureTable.size(); }
+	size_t GetShaderResourceViewCount() { return textureTable.Size(); }
 	
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(std::string_view name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	size_t GetSamplerCount() { return samplerTable.size(); }
+	size_t GetSamplerCount() { return samplerTable.Size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(std::string_view name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 	
 	// Misc getters
 	ID3DBlob* GetShaderBlob() { return shaderBlob; }
 
+	// Reads shader code and reflection without touching the
+	// device (thread safe), for use with the blob constructors
+	static bool ReadShaderFile(LPCWSTR shaderFile, ID3DBlob** blob, ShaderReflectionData& reflection);
+	static bool ReflectShaderBlob(ID3DBlob* shaderBlob, ShaderReflectionData& reflection);
+
 protected:
 	
+	static unsigned int nextId;
+	unsigned int id;
 	bool shaderValid;
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
@@ -124,23 +270,41 @@ protected:
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
 	std::vector<SimpleSRV*>		shaderResourceViews;
 	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+	SimpleShaderNameTable<SimpleConstantBuffer*> cbTable;
+	SimpleShaderNameTable<SimpleShaderVariable> varTable;
+	SimpleShaderNameTable<SimpleSRV*> textureTable;
+	SimpleShaderNameTable<SimpleSampler*> samplerTable;
+
+	// Raw reflection results, filled in before CreateShader()
+	// so derived classes can build input layouts, etc.
+	ShaderReflectionData reflection;
 
-	// Initialization method
+	// Initialization methods
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderBlob(ID3DBlob* blob, const ShaderReflectionData& reflection);
+
+	// On-disk reflection cache
+	static bool ReadReflectionCache(LPCWSTR cacheFile, uint64_t contentHash, ShaderReflectionData& reflection);
+	static bool WriteReflectionCache(LPCWSTR cacheFile, uint64_t contentHash, const ShaderReflectionData& reflection);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual SimpleShaderStage GetStage() = 0;
+
+	// Staged SRVs and samplers for each stage, shared by every
+	// shader (assumes all shaders draw with one device context)
+	static SimpleShaderStageBindings stageBindings[(int)SimpleShaderStage::Count];
 
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(std::string_view name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(std::string_view name);
+
+	// Non-template halves of SetStruct() and ValidateStruct()
+	bool SetStructData(SimpleConstantBuffer* cb, const void* data, size_t size, size_t typeHash, const SimpleShaderStructField* fields, unsigned int fieldCount);
+	bool ValidateStructLayout(SimpleConstantBuffer* cb, size_t size, size_t typeHash, const SimpleShaderStructField* fields, unsigned int fieldCount);
 };
 
 // --------------------------------------------------------
@@ -151,13 +315,18 @@ class SimpleVertexShader : public ISimpleShader
 public:
 	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, LPCWSTR shaderFile);
 	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, LPCWSTR shaderFile, ID3D11InputLayout* inputLayout, bool perInstanceCompatible);
+	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
 	~SimpleVertexShader();
 	ID3D11VertexShader* GetDirectXShader() { return shader; }
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState);
+
+	// Process-wide input layout cache management
+	static void ReleaseInputLayoutCache();
+	static void ResetBoundInputLayout();
 
 protected:
 	bool perInstanceCompatible;
@@ -165,7 +334,22 @@ protected:
 	ID3D11VertexShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	SimpleShaderStage GetStage() { return SimpleShaderStage::Vertex; }
 	void CleanUp();
+
+	// Shared input layouts, keyed by a hash of the reflected element descriptions
+	struct InputLayoutCacheEntry
+	{
+		ID3D11Device* Device;
+		std::string Signature;
+		ID3D11InputLayout* InputLayout;
+	};
+	static std::unordered_multimap<size_t, InputLayoutCacheEntry> inputLayoutCache;
+
+	// Last input layout bound through any vertex shader, so
+	// switching between shaders that share a layout skips the rebind
+	static ID3D11DeviceContext* boundContext;
+	static ID3D11InputLayout* boundInputLayout;
 };
 
 
@@ -176,16 +360,18 @@ class SimplePixelShader : public ISimpleShader
 {
 public:
 	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context, LPCWSTR shaderFile);
+	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11PixelShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	SimpleShaderStage GetStage() { return SimpleShaderStage::Pixel; }
 	void CleanUp();
 };
 
@@ -199,13 +385,14 @@ public:
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11DomainShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	SimpleShaderStage GetStage() { return SimpleShaderStage::Domain; }
 	void CleanUp();
 };
 
@@ -219,13 +406,14 @@ public:
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11HullShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	SimpleShaderStage GetStage() { return SimpleShaderStage::Hull; }
 	void CleanUp();
 };
 
@@ -239,8 +427,8 @@ public:
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
@@ -258,6 +446,7 @@ protected:
 	bool CreateShader(ID3DBlob* shaderBlob);
 	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	SimpleShaderStage GetStage() { return SimpleShaderStage::Geometry; }
 	void CleanUp();
 
 	// Helpers
@@ -272,21 +461,22 @@ class SimpleComputeShader : public ISimpleShader
 {
 public:
 	SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context, LPCWSTR shaderFile);
+	SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
 	~SimpleComputeShader();
 	ID3D11ComputeShader* GetDirectXShader() { return shader; }
 
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
+	bool SetShaderResourceView(std::string_view name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string_view name, ID3D11SamplerState* samplerState);
+	bool SetUnorderedAccessView(std::string_view name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(std::string_view name);
 
 protected:
 	ID3D11ComputeShader* shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
+	SimpleShaderNameTable<unsigned int> uavTable;
 
 	unsigned int threadsX;
 	unsigned int threadsY;
@@ -295,5 +485,6 @@ protected:
 
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	SimpleShaderStage GetStage() { return SimpleShaderStage::Compute; }
 	void CleanUp();
 };
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "TestFramework.h"
+#include "BlurKernel.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// --------------------------------------------------------
+// Rows to blur: noise (from a fixed seed), a single bright
+// texel and a hard edge
+// --------------------------------------------------------
+static std::vector<std::vector<float>> MakeRows(int count)
+{
+	std::vector<float> noise(count), impulse(count, 0.0f), edge(count);
+	uint32_t seed = 12345;
+	for (int x = 0; x < count; x++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		noise[x] = (seed >> 8) / 16777216.0f;
+		edge[x] = x < count / 2 ? 0.0f : 1.0f;
+	}
+	impulse[count / 2] = 1.0f;
+	return { noise, impulse, edge };
+}
+
+// Largest difference between the two ways of blurring a row
+static float MaxDifference(const BlurKernel& kernel, const std::vector<float>& row)
+{
+	int count = (int)row.size();
+	std::vector<float> discrete(count), bilinear(count);
+	kernel.ApplyDiscrete(row.data(), discrete.data(), count);
+	kernel.ApplyBilinear(row.data(), bilinear.data(), count);
+
+	float difference = 0;
+	for (int x = 0; x < count; x++)
+		difference = fmaxf(difference, fabsf(discrete[x] - bilinear[x]));
+	return difference;
+}
+
+TEST(BilinearMatchesDiscreteForEveryRadius)
+{
+	// Long rows, and rows shorter than the kernel so every
+	// tap is clamping at the ends
+	for (int radius = 0; radius <= BlurKernel::MaxRadius; radius++)
+	{
+		BlurKernel kernel(radius);
+		for (int count : { 64, 5 })
+		{
+			for (const std::vector<float>& row : MakeRows(count))
+			{
+				float difference = MaxDifference(kernel, row);
+				if (difference > 2e-6f)
+					printf("  radius %d, %d texels: off by %g\n", radius, count, difference);
+				CHECK(difference <= 2e-6f);
+			}
+		}
+	}
+}
+
+TEST(WeightsAreNormalized)
+{
+	for (int radius = 0; radius <= BlurKernel::MaxRadius; radius++)
+	{
+		BlurKernel kernel(radius);
+		const std::vector<float>& weights = kernel.GetWeights();
+		CHECK((int)weights.size() == radius + 1);
+
+		double total = weights[0];
+		for (size_t i = 1; i < weights.size(); i++)
+		{
+			CHECK(weights[i] <= weights[i - 1]);
+			total += 2.0 * weights[i];
+		}
+		CHECK_NEAR(total, 1.0, 1e-6);
+
+		// The taps carry the same total
+		double tapTotal = kernel.GetTaps()[0].Weight;
+		for (size_t i = 1; i < kernel.GetTaps().size(); i++)
+			tapTotal += 2.0 * kernel.GetTaps()[i].Weight;
+		CHECK_NEAR(tapTotal, 1.0, 1e-6);
+	}
+}
+
+TEST(TapsFitTheShader)
+{
+	for (int radius = 0; radius <= BlurKernel::MaxRadius; radius++)
+	{
+		BlurKernel kernel(radius);
+		const std::vector<BlurTap>& taps = kernel.GetTaps();
+		CHECK((int)taps.size() == radius / 2 + 1 + (radius % 2));
+		CHECK((int)taps.size() <= BlurKernel::MaxTaps);
+
+		// Each merged tap sits between the texels it covers
+		CHECK(taps[0].Offset == 0.0f);
+		for (size_t i = 1; i < taps.size(); i++)
+		{
+			CHECK(taps[i].Offset >= 2 * i - 1);
+			CHECK(taps[i].Offset <= 2 * i);
+		}
+	}
+}
+
+TEST(RadiusIsClamped)
+{
+	CHECK(BlurKernel(-3).GetRadius() == 0);
+	CHECK(BlurKernel(BlurKernel::MaxRadius + 10).GetRadius() == BlurKernel::MaxRadius);
+
+	// Radius 0 leaves the row alone
+	BlurKernel none(0);
+	for (const std::vector<float>& row : MakeRows(16))
+	{
+		std::vector<float> blurred(row.size());
+		none.ApplyBilinear(row.data(), blurred.data(), (int)row.size());
+		CHECK(blurred == row);
+	}
+}
+
+TEST(ConstantRowsStayConstant)
+{
+	std::vector<float> row(40, 0.25f), blurred(40);
+	for (int radius = 0; radius <= BlurKernel::MaxRadius; radius++)
+	{
+		BlurKernel(radius).ApplyBilinear(row.data(), blurred.data(), 40);
+		for (float value : blurred)
+			CHECK_NEAR(value, 0.25, 1e-6);
+	}
+}
+
+TEST(DownsampleLevelsBringTheRadiusInRange)
+{
+	CHECK(BlurKernel::GetDownsampleLevels(0, 4) == 0);
+	CHECK(BlurKernel::GetDownsampleLevels(BlurKernel::MaxRadius, 4) == 0);
+	CHECK(BlurKernel::GetDownsampleLevels(BlurKernel::MaxRadius + 1, 4) == 1);
+	CHECK(BlurKernel::GetDownsampleLevels(4 * BlurKernel::MaxRadius, 4) == 2);
+	CHECK(BlurKernel::GetDownsampleLevels(4 * BlurKernel::MaxRadius + 1, 4) == 3);
+
+	// Never more than asked for
+	CHECK(BlurKernel::GetDownsampleLevels(1000, 2) == 2);
+}
@@ -0,0 +1,148 @@
+#include "TestFramework.h"
+#include "DynamicResolution.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A frame time trace from Tests/Traces: each frame's time at
+// full resolution and the scale expected after it
+// --------------------------------------------------------
+struct FrameTrace
+{
+	float TargetFrameTime = 0;
+	std::vector<float> FullScaleTimes;
+	std::vector<float> ExpectedScales;
+};
+
+static bool LoadTrace(const char* name, FrameTrace* trace)
+{
+	std::ifstream file(std::string(TRACE_DIRECTORY) + name + ".trace");
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream values(line);
+		if (line.compare(0, 6, "target") == 0)
+		{
+			std::string keyword;
+			values >> keyword >> trace->TargetFrameTime;
+			continue;
+		}
+
+		float time, scale;
+		if (values >> time >> scale)
+		{
+			trace->FullScaleTimes.push_back(time);
+			trace->ExpectedScales.push_back(scale);
+		}
+	}
+
+	return trace->TargetFrameTime > 0 && !trace->FullScaleTimes.empty();
+}
+
+// --------------------------------------------------------
+// Replays a trace, with frame time following the pixel count
+// (the full resolution time times scale squared), checking
+// every frame's scale.  Returns the last scale
+// --------------------------------------------------------
+static float ReplayTrace(const char* name)
+{
+	FrameTrace trace;
+	bool loaded = LoadTrace(name, &trace);
+	CHECK(loaded);
+	if (!loaded)
+		return 0;
+
+	DynamicResolution resolution(trace.TargetFrameTime);
+	float scale = resolution.GetScale();
+	int mismatches = 0;
+	for (size_t frame = 0; frame < trace.FullScaleTimes.size(); frame++)
+	{
+		scale = resolution.Update(trace.FullScaleTimes[frame] * scale * scale);
+
+		// Report the first few mismatches, not all 300
+		if (fabsf(scale - trace.ExpectedScales[frame]) > 1e-4f && mismatches++ < 3)
+		{
+			printf("  %s.trace frame %d: ", name, (int)frame);
+			CHECK_NEAR(scale, trace.ExpectedScales[frame], 1e-4);
+		}
+	}
+	CHECK(mismatches == 0);
+	return scale;
+}
+
+TEST(SteadyTraceStaysAtFullScale)
+{
+	CHECK_NEAR(ReplayTrace("steady"), 1.0, 1e-4);
+}
+
+TEST(SpikeTraceRecovers)
+{
+	CHECK_NEAR(ReplayTrace("spike"), 1.0, 1e-4);
+}
+
+TEST(OverloadTraceSettlesAtTheLargestScaleThatFits)
+{
+	CHECK_NEAR(ReplayTrace("overload"), 0.8, 1e-4);
+}
+
+TEST(RecoveryTraceReturnsToFullScale)
+{
+	CHECK_NEAR(ReplayTrace("recovery"), 1.0, 1e-4);
+}
+
+TEST(OscillationTraceDoesntFlipFlop)
+{
+	CHECK_NEAR(ReplayTrace("oscillation"), 0.95, 1e-4);
+}
+
+TEST(SameTraceGivesSameScales)
+{
+	FrameTrace trace;
+	CHECK(LoadTrace("recovery", &trace));
+
+	DynamicResolution first(trace.TargetFrameTime);
+	DynamicResolution second(trace.TargetFrameTime);
+	for (float time : trace.FullScaleTimes)
+		CHECK(first.Update(time) == second.Update(time));
+}
+
+TEST(NonsenseFrameTimesAreIgnored)
+{
+	DynamicResolution resolution(1.0f / 60.0f);
+	for (int frame = 0; frame < 100; frame++)
+	{
+		CHECK(resolution.Update(0.0f) == 1.0f);
+		CHECK(resolution.Update(-1.0f) == 1.0f);
+	}
+	CHECK(resolution.GetAverageFrameTime() == 0.0f);
+}
+
+TEST(ScaleStaysWithinLimits)
+{
+	DynamicResolution resolution(1.0f / 60.0f, 0.6f, 0.9f);
+	CHECK(resolution.GetScale() == 0.9f);
+
+	// Hopelessly over budget, then hopelessly under
+	for (int frame = 0; frame < 200; frame++)
+		resolution.Update(1.0f);
+	CHECK_NEAR(resolution.GetScale(), 0.6, 1e-6);
+
+	for (int frame = 0; frame < 200; frame++)
+		resolution.Update(0.001f);
+	CHECK_NEAR(resolution.GetScale(), 0.9, 1e-6);
+
+	resolution.Update(1.0f);
+	resolution.Reset();
+	CHECK(resolution.GetScale() == 0.9f);
+	CHECK(resolution.GetAverageFrameTime() == 0.0f);
+}
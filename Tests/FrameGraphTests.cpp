@@ -0,0 +1,203 @@
+#include "TestFramework.h"
+#include "FrameGraph.h"
+
+#include <algorithm>
+#include <vector>
+
+static const FrameGraphTextureDesc Desc = { 64, 64, 28 };
+
+static bool Contains(const std::vector<FrameGraphResource>& resources, FrameGraphResource resource)
+{
+	return std::find(resources.begin(), resources.end(), resource) != resources.end();
+}
+
+// --------------------------------------------------------
+// A small frame: scene -> blur -> post -> UI on the back
+// buffer, a debug view nothing reads, and a stats pass that
+// only has side effects
+// --------------------------------------------------------
+struct TestFrame
+{
+	FrameGraph graph;
+	FrameGraphResource backBuffer, depth, sceneColor, blurred, debugView;
+	enum { Scene, Debug, Blur, Post, UI, Stats };
+
+	TestFrame()
+	{
+		backBuffer = graph.ImportResource("BackBuffer");
+		depth = graph.ImportResource("Depth");
+		sceneColor = graph.CreateTexture("SceneColor", Desc);
+		blurred = graph.CreateTexture("Blurred", Desc);
+		debugView = graph.CreateTexture("DebugView", Desc);
+		graph.MarkOutput(backBuffer);
+
+		graph.AddPass("Scene", [] {}).Write(sceneColor).Access(depth, FrameGraphAccess::DepthStencil);
+		graph.AddPass("Debug", [] {}).Read(sceneColor).Write(debugView);
+		graph.AddPass("Blur", [] {}).Read(sceneColor).Write(blurred);
+		graph.AddPass("Post", [] {}).Read(blurred).Read(sceneColor).Write(backBuffer);
+		graph.AddPass("UI", [] {}).Write(backBuffer);
+		graph.AddPass("Stats", [] {}).Read(depth).SideEffects = true;
+	}
+};
+
+TEST(PassesNothingNeedsAreCulled)
+{
+	TestFrame frame;
+	CHECK(frame.graph.Compile());
+
+	CHECK(frame.graph.IsPassCulled(TestFrame::Debug));
+	for (unsigned int pass : { TestFrame::Scene, TestFrame::Blur, TestFrame::Post, TestFrame::UI, TestFrame::Stats })
+		CHECK(!frame.graph.IsPassCulled(pass));
+
+	// The rest run in declaration order
+	const std::vector<FrameGraphStep>& steps = frame.graph.GetSteps();
+	unsigned int expected[] = { TestFrame::Scene, TestFrame::Blur, TestFrame::Post, TestFrame::UI, TestFrame::Stats };
+	CHECK(steps.size() == 5);
+	for (size_t s = 0; s < steps.size() && s < 5; s++)
+		CHECK(steps[s].Pass == expected[s]);
+}
+
+TEST(EverythingIsCulledWithoutOutputsOrSideEffects)
+{
+	FrameGraph graph;
+	FrameGraphResource a = graph.CreateTexture("A", Desc);
+	FrameGraphResource b = graph.CreateTexture("B", Desc);
+	graph.AddPass("First", [] {}).Write(a);
+	graph.AddPass("Second", [] {}).Read(a).Write(b);
+	CHECK(graph.Compile());
+
+	CHECK(graph.GetSteps().empty());
+	CHECK(graph.IsPassCulled(0));
+	CHECK(graph.IsPassCulled(1));
+
+	// Marking the end of the chain keeps all of it
+	graph.MarkOutput(b);
+	CHECK(graph.Compile());
+	CHECK(graph.GetSteps().size() == 2);
+}
+
+TEST(TransientsLiveFromFirstToLastUse)
+{
+	TestFrame frame;
+	CHECK(frame.graph.Compile());
+	const std::vector<FrameGraphStep>& steps = frame.graph.GetSteps();
+	if (steps.size() != 5)
+		return;
+
+	// Steps: Scene, Blur, Post, UI, Stats
+	CHECK(Contains(steps[0].Acquire, frame.sceneColor));
+	CHECK(Contains(steps[2].Release, frame.sceneColor));
+	CHECK(Contains(steps[1].Acquire, frame.blurred));
+	CHECK(Contains(steps[2].Release, frame.blurred));
+
+	// Imported resources, and transients only culled passes
+	// use, are never acquired
+	for (const FrameGraphStep& step : steps)
+	{
+		for (FrameGraphResource resource : { frame.backBuffer, frame.depth, frame.debugView })
+		{
+			CHECK(!Contains(step.Acquire, resource));
+			CHECK(!Contains(step.Release, resource));
+		}
+	}
+
+	CHECK(steps[0].Acquire.size() == 1 && steps[0].Release.empty());
+	CHECK(steps[1].Acquire.size() == 1 && steps[1].Release.empty());
+	CHECK(steps[2].Acquire.empty() && steps[2].Release.size() == 2);
+	CHECK(steps[3].Acquire.empty() && steps[3].Release.empty());
+}
+
+TEST(ReadingABoundOutputUnbindsOutputs)
+{
+	TestFrame frame;
+	CHECK(frame.graph.Compile());
+	const std::vector<FrameGraphStep>& steps = frame.graph.GetSteps();
+	if (steps.size() != 5)
+		return;
+
+	// Blur reads the scene color Scene left bound as a render
+	// target, and Post reads Blur's
+	CHECK(!steps[0].UnbindOutputs);
+	CHECK(steps[1].UnbindOutputs);
+	CHECK(steps[2].UnbindOutputs);
+
+	// UI writes the already bound back buffer, and by Stats the
+	// depth buffer was unbound when Blur bound its own output
+	CHECK(!steps[3].UnbindOutputs);
+	CHECK(!steps[4].UnbindOutputs);
+
+	for (const FrameGraphStep& step : steps)
+		CHECK(!step.UnbindShaderResources);
+}
+
+TEST(WritingABoundInputUnbindsShaderResources)
+{
+	// Particles blend onto the scene color after Blur has read it
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("BackBuffer");
+	FrameGraphResource sceneColor = graph.CreateTexture("SceneColor", Desc);
+	FrameGraphResource blurred = graph.CreateTexture("Blurred", Desc);
+	graph.MarkOutput(backBuffer);
+
+	graph.AddPass("Scene", [] {}).Write(sceneColor);
+	graph.AddPass("Blur", [] {}).Read(sceneColor).Write(blurred);
+	graph.AddPass("Particles", [] {}).Write(sceneColor);
+	graph.AddPass("Post", [] {}).Read(sceneColor).Read(blurred).Write(backBuffer);
+	CHECK(graph.Compile());
+
+	const std::vector<FrameGraphStep>& steps = graph.GetSteps();
+	CHECK(steps.size() == 4);
+	if (steps.size() != 4)
+		return;
+
+	CHECK(!steps[1].UnbindShaderResources);
+	CHECK(steps[2].UnbindShaderResources);
+	CHECK(!steps[3].UnbindShaderResources);
+
+	// Post reads both textures while they're bound as outputs
+	CHECK(steps[3].UnbindOutputs);
+}
+
+TEST(WritesKeepEarlierWritersAlive)
+{
+	// Particles only write the scene color, but keep what Scene
+	// drew, so Scene must run even though nothing reads it before
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("BackBuffer");
+	graph.MarkOutput(backBuffer);
+	graph.AddPass("Scene", [] {}).Write(backBuffer);
+	graph.AddPass("Particles", [] {}).Write(backBuffer);
+	graph.AddPass("Unrelated", [] {}).Write(graph.CreateTexture("Unused", Desc));
+	CHECK(graph.Compile());
+
+	CHECK(!graph.IsPassCulled(0));
+	CHECK(!graph.IsPassCulled(1));
+	CHECK(graph.IsPassCulled(2));
+}
+
+TEST(AccessesOnlyCountLivePasses)
+{
+	TestFrame frame;
+	CHECK(frame.graph.Compile());
+
+	std::vector<FrameGraphAccess> accesses = frame.graph.GetResourceAccesses(frame.sceneColor);
+	CHECK(accesses.size() == 3);
+	CHECK(std::count(accesses.begin(), accesses.end(), FrameGraphAccess::RenderTarget) == 1);
+	CHECK(std::count(accesses.begin(), accesses.end(), FrameGraphAccess::ShaderRead) == 2);
+
+	CHECK(frame.graph.GetResourceAccesses(frame.debugView).empty());
+}
+
+TEST(UnknownResourcesFailToCompile)
+{
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("BackBuffer");
+	graph.MarkOutput(backBuffer);
+	graph.AddPass("Bad", [] {}).Read(backBuffer + 5).Write(backBuffer);
+	CHECK(!graph.Compile());
+
+	graph.Reset();
+	CHECK(graph.GetPassCount() == 0);
+	CHECK(graph.Compile());
+	CHECK(graph.GetSteps().empty());
+}
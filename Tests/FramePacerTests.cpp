@@ -0,0 +1,207 @@
+#include "TestFramework.h"
+#include "FramePacer.h"
+
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// A clock that only moves when told to.  Now() ticks forward
+// a microsecond per call (so the pacer's spin loop ends), and
+// Sleep() overshoots by a set amount, like a real scheduler
+// --------------------------------------------------------
+class FakeClock : public FrameClock
+{
+public:
+	double Time = 0;
+	double Tick = 1e-6;
+	double Oversleep = 0;
+	std::vector<double> Sleeps;
+	int NowCalls = 0;
+
+	double Now() override
+	{
+		NowCalls++;
+		Time += Tick;
+		return Time;
+	}
+
+	void Sleep(double seconds) override
+	{
+		Sleeps.push_back(seconds);
+		Time += seconds + Oversleep;
+	}
+
+	void Work(double seconds) { Time += seconds; }
+};
+
+static const double Period = 0.01;	// 100 fps
+static const double Work = 0.003;
+
+TEST(FirstFrameStartsTheSchedule)
+{
+	auto clock = std::make_shared<FakeClock>();
+	clock->Time = 0.5;
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+
+	// Nothing to wait for yet
+	pacer.WaitForNextFrame();
+	double start = clock->Time;
+	CHECK(clock->Sleeps.empty());
+	CHECK(pacer.GetLastWaitTime() == 0);
+
+	// The next frame is due one period later
+	clock->Work(Work);
+	pacer.WaitForNextFrame();
+	CHECK_NEAR(clock->Time, start + Period, 1e-5);
+}
+
+TEST(SleepsThenSpinsUpToTheDeadline)
+{
+	auto clock = std::make_shared<FakeClock>();
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+
+	pacer.WaitForNextFrame();
+	double deadline = clock->Time + Period;
+
+	clock->Work(Work);
+	int nowCallsBefore = clock->NowCalls;
+	pacer.WaitForNextFrame();
+
+	// One sleep, stopping SpinTime short of the deadline...
+	CHECK(clock->Sleeps.size() == 1);
+	if (clock->Sleeps.size() == 1)
+		CHECK_NEAR(clock->Sleeps[0], Period - Work - FramePacer::SpinTime, 1e-5);
+
+	// ...then spinning on the clock for the rest
+	CHECK(clock->NowCalls - nowCallsBefore > 100);
+	CHECK(clock->Time >= deadline);
+	CHECK_NEAR(clock->Time, deadline, 1e-5);
+}
+
+TEST(OversleepingWithinSpinTimeStaysOnSchedule)
+{
+	auto clock = std::make_shared<FakeClock>();
+	clock->Oversleep = 0.0015;
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+
+	pacer.WaitForNextFrame();
+	double start = clock->Time;
+	for (int frame = 1; frame <= 100; frame++)
+	{
+		clock->Work(Work);
+		pacer.WaitForNextFrame();
+		CHECK_NEAR(clock->Time, start + frame * Period, 1e-5);
+	}
+}
+
+TEST(OversleepingPastTheDeadlineDoesntDrift)
+{
+	// Each sleep lands 2ms late, but the deadlines stay one
+	// period apart, so frames are late by the same amount
+	// every time rather than later and later
+	auto clock = std::make_shared<FakeClock>();
+	clock->Oversleep = 0.004;
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+
+	pacer.WaitForNextFrame();
+	double start = clock->Time;
+	double late = clock->Oversleep - FramePacer::SpinTime;
+	for (int frame = 1; frame <= 100; frame++)
+	{
+		clock->Work(Work);
+		pacer.WaitForNextFrame();
+		CHECK_NEAR(clock->Time, start + frame * Period + late, 1e-5);
+	}
+}
+
+TEST(FramesMoreThanAPeriodLateRestartTheSchedule)
+{
+	auto clock = std::make_shared<FakeClock>();
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+
+	pacer.WaitForNextFrame();
+	clock->Work(Work);
+	pacer.WaitForNextFrame();
+
+	// A long hitch - don't rush through frames to catch up
+	clock->Work(5 * Period);
+	size_t sleepsBefore = clock->Sleeps.size();
+	pacer.WaitForNextFrame();
+	double restart = clock->Time;
+	CHECK(clock->Sleeps.size() == sleepsBefore);
+	CHECK(pacer.GetLastWaitTime() == 0);
+
+	// Back to normal, one period after the late frame
+	clock->Work(Work);
+	pacer.WaitForNextFrame();
+	CHECK_NEAR(clock->Time, restart + Period, 1e-5);
+}
+
+TEST(ZeroFrameRateDoesntLimit)
+{
+	auto clock = std::make_shared<FakeClock>();
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+	pacer.WaitForNextFrame();
+
+	pacer.SetTargetFrameRate(0);
+	CHECK(pacer.GetTargetFrameRate() == 0);
+	for (int frame = 0; frame < 10; frame++)
+	{
+		double before = clock->Time;
+		pacer.WaitForNextFrame();
+		CHECK(clock->Time == before);
+		CHECK(pacer.GetLastWaitTime() == 0);
+		clock->Work(Work);
+	}
+	CHECK(clock->Sleeps.empty());
+
+	// Negative rates also mean no limit
+	pacer.SetTargetFrameRate(-30);
+	CHECK(pacer.GetTargetFrameRate() == 0);
+}
+
+TEST(LastWaitTimeIsTheTimeHeldBack)
+{
+	auto clock = std::make_shared<FakeClock>();
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+
+	pacer.WaitForNextFrame();
+	for (int frame = 0; frame < 10; frame++)
+	{
+		// Varying work; the wait makes up the rest of the period
+		double work = 0.001 * (frame % 5 + 1);
+		clock->Work(work);
+		double before = clock->Time;
+		pacer.WaitForNextFrame();
+		CHECK_NEAR(pacer.GetLastWaitTime(), clock->Time - before, 1e-5);
+		CHECK_NEAR(pacer.GetLastWaitTime(), Period - work, 1e-5);
+	}
+}
+
+TEST(ChangingTheRateRestartsTheSchedule)
+{
+	auto clock = std::make_shared<FakeClock>();
+	FramePacer pacer(clock);
+	pacer.SetTargetFrameRate(100);
+	pacer.WaitForNextFrame();
+	clock->Work(Work);
+	pacer.WaitForNextFrame();
+
+	// The new rate starts from this frame, without waiting
+	pacer.SetTargetFrameRate(50);
+	clock->Work(Work);
+	pacer.WaitForNextFrame();
+	double start = clock->Time;
+	CHECK(pacer.GetLastWaitTime() == 0);
+
+	clock->Work(Work);
+	pacer.WaitForNextFrame();
+	CHECK_NEAR(clock->Time, start + 0.02, 1e-5);
+}
@@ -0,0 +1,189 @@
+#include "TestFramework.h"
+#include "LightClusters.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// A camera at the origin looking down +Z, with an aspect
+// ratio matching the 16x8 cluster grid
+// --------------------------------------------------------
+static const float NearClip = 0.1f;
+static const float FarClip = 100.0f;
+
+static void Build(LightClusters& clusters, const std::vector<PointLight>& lights)
+{
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixIdentity());
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 2.0f, NearClip, FarClip));
+	clusters.Build(lights.data(), lights.size(), view, projection, NearClip, FarClip);
+}
+
+static PointLight MakeLight(float x, float y, float z, float range)
+{
+	PointLight light = {};
+	light.position = XMFLOAT3(x, y, z);
+	light.range = range;
+	return light;
+}
+
+// Depth where slice "slice" starts
+static float SliceStart(unsigned int slice)
+{
+	return NearClip * powf(FarClip / NearClip, (float)slice / LightClusters::ClustersZ);
+}
+
+// The slice a pixel at this view depth looks up, as the shader does it
+static int SliceAt(LightClusters& clusters, float viewZ)
+{
+	return (int)floorf(logf(viewZ) * clusters.GetSliceScale() + clusters.GetSliceBias());
+}
+
+static bool ClusterHasLight(LightClusters& clusters, int slice, int x, int y, uint32_t light)
+{
+	const LightClusterRange& range = clusters.GetClusters()[(slice * LightClusters::ClustersY + y) * LightClusters::ClustersX + x];
+	for (uint32_t i = 0; i < range.Count; i++)
+	{
+		if (clusters.GetLightIndices()[range.Offset + i] == light)
+			return true;
+	}
+	return false;
+}
+
+// Whether any tile of the slice has the light
+static bool SliceHasLight(LightClusters& clusters, int slice, uint32_t light)
+{
+	for (int y = 0; y < (int)LightClusters::ClustersY; y++)
+		for (int x = 0; x < (int)LightClusters::ClustersX; x++)
+			if (ClusterHasLight(clusters, slice, x, y, light))
+				return true;
+	return false;
+}
+
+TEST(SliceParametersMatchTheBoundaries)
+{
+	LightClusters clusters(nullptr);
+	Build(clusters, {});
+
+	for (unsigned int slice = 0; slice < LightClusters::ClustersZ; slice++)
+	{
+		float start = SliceStart(slice);
+		CHECK_NEAR(logf(start) * clusters.GetSliceScale() + clusters.GetSliceBias(), slice, 1e-4);
+		CHECK(SliceAt(clusters, start * 1.001f) == (int)slice);
+	}
+}
+
+TEST(LightOnASliceBoundaryIsInBothSlices)
+{
+	LightClusters clusters(nullptr);
+	const unsigned int boundary = 12;
+	float z = SliceStart(boundary);
+	Build(clusters, { MakeLight(0, 0, z, z * 0.02f) });
+
+	CHECK(!SliceHasLight(clusters, boundary - 2, 0));
+	CHECK(SliceHasLight(clusters, boundary - 1, 0));
+	CHECK(SliceHasLight(clusters, boundary, 0));
+	CHECK(!SliceHasLight(clusters, boundary + 1, 0));
+
+	// Pixels just either side of the boundary, in the middle
+	// of the screen, find it
+	for (float offset : { -1e-3f, 1e-3f })
+	{
+		int slice = SliceAt(clusters, z * (1.0f + offset));
+		CHECK(ClusterHasLight(clusters, slice, LightClusters::ClustersX / 2, LightClusters::ClustersY / 2, 0));
+		CHECK(ClusterHasLight(clusters, slice, LightClusters::ClustersX / 2 - 1, LightClusters::ClustersY / 2 - 1, 0));
+	}
+}
+
+TEST(LightEndingOnASliceBoundaryReachesIt)
+{
+	// The sphere's near edge is exactly where slice 8 starts
+	LightClusters clusters(nullptr);
+	float start = SliceStart(8);
+	float range = start * 0.05f;
+	Build(clusters, { MakeLight(0, 0, start + range, range) });
+
+	CHECK(SliceHasLight(clusters, SliceAt(clusters, start * 1.0001f), 0));
+	CHECK(!SliceHasLight(clusters, 6, 0));
+}
+
+TEST(EveryPointInsideALightFindsIt)
+{
+	// Lights straddling every boundary, at different places
+	// on screen: sample depths through each sphere and check
+	// the cluster a pixel there would use has the light
+	std::vector<PointLight> lights;
+	for (unsigned int boundary = 1; boundary < LightClusters::ClustersZ; boundary++)
+	{
+		float z = SliceStart(boundary);
+		float x = z * (((int)boundary % 5) - 2) * 0.6f;
+		lights.push_back(MakeLight(x, 0, z, z * 0.1f));
+	}
+
+	LightClusters clusters(nullptr);
+	Build(clusters, lights);
+
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 2.0f, NearClip, FarClip);
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, projection);
+
+	for (uint32_t i = 0; i < (uint32_t)lights.size(); i++)
+	{
+		const PointLight& light = lights[i];
+		for (int step = -9; step <= 9; step++)
+		{
+			float viewZ = light.position.z + light.range * step / 10.0f;
+			float ndcX = light.position.x * p._11 / viewZ;
+			if (viewZ < NearClip || fabsf(ndcX) >= 1.0f)
+				continue;
+
+			int tileX = (int)floorf((ndcX * 0.5f + 0.5f) * LightClusters::ClustersX);
+			CHECK(ClusterHasLight(clusters, SliceAt(clusters, viewZ), tileX, LightClusters::ClustersY / 2, i));
+		}
+	}
+}
+
+TEST(LightsOutsideTheDepthRangeAreSkipped)
+{
+	LightClusters clusters(nullptr);
+	Build(clusters, {
+		MakeLight(0, 0, -5, 1),		// Behind the camera
+		MakeLight(0, 0, 150, 10) });	// Past the far plane
+
+	CHECK(clusters.GetLightIndices().empty());
+}
+
+TEST(LightReachingPastTheNearPlaneCoversTheScreen)
+{
+	LightClusters clusters(nullptr);
+	Build(clusters, { MakeLight(0, 0, 0.5f, 1.0f) });
+
+	for (int y = 0; y < (int)LightClusters::ClustersY; y++)
+		for (int x = 0; x < (int)LightClusters::ClustersX; x++)
+			CHECK(ClusterHasLight(clusters, 0, x, y, 0));
+}
+
+TEST(ThreadedMatchesSerial)
+{
+	std::vector<PointLight> lights;
+	for (int i = 0; i < 37; i++)
+		lights.push_back(MakeLight((float)(i % 7 - 3) * 4.0f, (float)(i % 3 - 1) * 2.0f, 1.0f + i * 2.5f, 1.0f + (i % 4)));
+
+	ThreadPool threadPool(4);
+	LightClusters serial(nullptr);
+	LightClusters threaded(&threadPool);
+	Build(serial, lights);
+	Build(threaded, lights);
+
+	CHECK(serial.GetLightIndices() == threaded.GetLightIndices());
+	bool sameClusters = true;
+	for (unsigned int i = 0; i < LightClusters::ClusterCount; i++)
+	{
+		sameClusters = sameClusters &&
+			serial.GetClusters()[i].Offset == threaded.GetClusters()[i].Offset &&
+			serial.GetClusters()[i].Count == threaded.GetClusters()[i].Count;
+	}
+	CHECK(sameClusters);
+}
@@ -0,0 +1,180 @@
+#include "TestFramework.h"
+#include "OcclusionCuller.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// A camera at the origin looking down +Z with a 90 degree
+// field of view, so a point's NDC x and y are just x/z and
+// y/z.  On the 128x128 buffer that's 4x8 tiles
+// --------------------------------------------------------
+static const unsigned int Size = 128;
+
+static void BeginFrame(OcclusionCuller& culler)
+{
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixIdentity());
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 100.0f));
+	culler.Begin(view, projection);
+}
+
+// --------------------------------------------------------
+// A wall covering the left half of the view, from NDC x of
+// -0.8 (pixel 12.8) to 0 (pixel 64): tile column 1 is fully
+// covered and column 0 only partly
+// --------------------------------------------------------
+static void AddWall(OcclusionCuller& culler)
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	culler.AddOccluder(OccluderMesh::MakeBox(XMFLOAT3(-4, -4, 5), XMFLOAT3(0, 4, 6)), world);
+}
+
+static bool IsVisible(const OcclusionCuller& culler, XMFLOAT3 center, XMFLOAT3 extents)
+{
+	BoundsSoA bounds = { &center.x, &center.y, &center.z, &extents.x, &extents.y, &extents.z };
+	uint8_t visible = 1;
+	culler.TestBoxes(bounds, 1, &visible);
+	return visible != 0;
+}
+
+TEST(BoxBehindAnOccluderIsHidden)
+{
+	OcclusionCuller culler(Size, Size, nullptr);
+	BeginFrame(culler);
+	AddWall(culler);
+	culler.Rasterize();
+
+	// Pixels 47-55, inside the fully covered tile column
+	CHECK(!IsVisible(culler, XMFLOAT3(-4, 0, 20), XMFLOAT3(1, 1, 1)));
+}
+
+TEST(BoxBesideAnOccluderIsVisible)
+{
+	OcclusionCuller culler(Size, Size, nullptr);
+	BeginFrame(culler);
+	AddWall(culler);
+	culler.Rasterize();
+
+	// Pixels 85-94, right of the wall
+	CHECK(IsVisible(culler, XMFLOAT3(8, 0, 20), XMFLOAT3(1, 1, 1)));
+
+	// In front of the wall
+	CHECK(IsVisible(culler, XMFLOAT3(-2, 0, 3), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+}
+
+TEST(PartlyCoveredTilesAreTestedPerPixel)
+{
+	OcclusionCuller culler(Size, Size, nullptr);
+	BeginFrame(culler);
+	AddWall(culler);
+	culler.Rasterize();
+
+	// Tile column 0 on the middle row has both clear pixels (left
+	// of the wall) and covered ones, so the farthest depth can't
+	// decide anything there
+	const float* depth = culler.GetDepth();
+	unsigned int row = Size / 2 * culler.GetWidth();
+	CHECK(depth[row + 4] == 1.0f);
+	CHECK(depth[row + 20] < 1.0f);
+
+	// Pixels 17-25: all behind the wall
+	CHECK(!IsVisible(culler, XMFLOAT3(-20, 0, 30), XMFLOAT3(1, 1, 1)));
+
+	// Pixels 6-15: partly past its edge
+	CHECK(IsVisible(culler, XMFLOAT3(-25, 0, 30), XMFLOAT3(1, 1, 1)));
+}
+
+TEST(BoxCrossingTheNearPlaneIsVisible)
+{
+	OcclusionCuller culler(Size, Size, nullptr);
+	BeginFrame(culler);
+	AddWall(culler);
+	culler.Rasterize();
+
+	// Reaches from behind the camera to behind the wall
+	CHECK(IsVisible(culler, XMFLOAT3(-2, 0, 3), XMFLOAT3(1, 1, 4)));
+}
+
+TEST(OccluderCrossingTheNearPlaneIsDropped)
+{
+	OcclusionCuller culler(Size, Size, nullptr);
+	BeginFrame(culler);
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	culler.AddOccluder(OccluderMesh::MakeBox(XMFLOAT3(-4, -4, -1), XMFLOAT3(0, 4, 6)), world);
+	culler.Rasterize();
+
+	// Only the far face survives
+	CHECK(culler.GetTriangleCount() == 2);
+	CHECK(!IsVisible(culler, XMFLOAT3(-4, 0, 20), XMFLOAT3(1, 1, 1)));
+}
+
+TEST(BeginClearsTheOccluders)
+{
+	OcclusionCuller culler(Size, Size, nullptr);
+	BeginFrame(culler);
+	AddWall(culler);
+	culler.Rasterize();
+	CHECK(!IsVisible(culler, XMFLOAT3(-4, 0, 20), XMFLOAT3(1, 1, 1)));
+
+	BeginFrame(culler);
+	culler.Rasterize();
+	CHECK(culler.GetTriangleCount() == 0);
+	CHECK(IsVisible(culler, XMFLOAT3(-4, 0, 20), XMFLOAT3(1, 1, 1)));
+}
+
+TEST(ThreadedMatchesSerial)
+{
+	ThreadPool threadPool(4);
+	OcclusionCuller serial(Size, Size, nullptr);
+	OcclusionCuller threaded(Size, Size, &threadPool);
+
+	// A grid of boxes behind and around the wall, with
+	// every third one already culled
+	std::vector<float> centerX, centerY, centerZ, extent;
+	for (int y = -10; y <= 10; y += 2)
+	{
+		for (int x = -30; x <= 30; x += 3)
+		{
+			centerX.push_back((float)x);
+			centerY.push_back((float)y);
+			centerZ.push_back(25.0f);
+			extent.push_back(1.0f);
+		}
+	}
+	BoundsSoA bounds = { centerX.data(), centerY.data(), centerZ.data(), extent.data(), extent.data(), extent.data() };
+
+	std::vector<uint8_t> serialVisible(centerX.size()), threadedVisible(centerX.size());
+	for (size_t i = 0; i < centerX.size(); i++)
+		serialVisible[i] = threadedVisible[i] = i % 3 != 0;
+
+	OcclusionCuller* cullers[] = { &serial, &threaded };
+	for (OcclusionCuller* culler : cullers)
+	{
+		BeginFrame(*culler);
+		AddWall(*culler);
+		culler->Rasterize();
+	}
+	serial.TestBoxes(bounds, centerX.size(), serialVisible.data());
+	threaded.TestBoxes(bounds, centerX.size(), threadedVisible.data());
+
+	CHECK(serialVisible == threadedVisible);
+	CHECK(std::vector<float>(serial.GetDepth(), serial.GetDepth() + Size * Size) ==
+		std::vector<float>(threaded.GetDepth(), threaded.GetDepth() + Size * Size));
+
+	// Some hidden, some not, and culled ones stay culled
+	size_t hidden = 0;
+	for (size_t i = 0; i < serialVisible.size(); i++)
+	{
+		if (i % 3 == 0)
+			CHECK(serialVisible[i] == 0);
+		else if (!serialVisible[i])
+			hidden++;
+	}
+	CHECK(hidden > 0);
+	CHECK(hidden < serialVisible.size() * 2 / 3);
+}
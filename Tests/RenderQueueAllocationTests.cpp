@@ -0,0 +1,290 @@
+#include "TestFramework.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "BufferStructs.h"
+#include "Camera.h"
+#include "Entity.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "RenderQueue.h"
+#include "ShaderPermutations.h"
+
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "d3dcompiler.lib")
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+// --------------------------------------------------------
+// Global operator new replacements that count allocations
+// while counting is switched on.  (D3D's own allocations
+// don't go through these - only ours do.)
+// --------------------------------------------------------
+static std::atomic<bool> countingAllocations(false);
+static std::atomic<int> allocationCount(0);
+
+void* operator new(size_t size)
+{
+	if (countingAllocations)
+		allocationCount++;
+
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (countingAllocations)
+		allocationCount++;
+
+	void* memory = _aligned_malloc(size ? size : 1, (size_t)alignment);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { _aligned_free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { _aligned_free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { _aligned_free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { _aligned_free(memory); }
+
+// --------------------------------------------------------
+// A headless (WARP) device with a small render target, and
+// a scene using the real lit shaders: an instanced material,
+// an instanced normal mapped one and a non-instanced one,
+// each on two meshes
+// --------------------------------------------------------
+struct TestScene
+{
+	ComPtr<ID3D11Device> device;
+	ComPtr<ID3D11DeviceContext> context;
+	ComPtr<ID3D11RenderTargetView> renderTarget;
+	ComPtr<ID3D11DepthStencilView> depthStencil;
+	ComPtr<ID3D11ShaderResourceView> texture;
+	ComPtr<ID3D11SamplerState> sampler;
+
+	std::shared_ptr<ShaderPermutations> vertexShaders;
+	std::shared_ptr<ShaderPermutations> pixelShaders;
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<std::unique_ptr<Entity>> entities;
+	std::unique_ptr<Camera> camera;
+	std::unique_ptr<RenderQueue> renderQueue;
+
+	bool Create();
+	void DrawFrame();
+};
+
+static std::shared_ptr<Mesh> MakeBoxMesh(ComPtr<ID3D11Device> device, float size)
+{
+	std::vector<Vertex> vertices;
+	for (int i = 0; i < 8; i++)
+	{
+		Vertex v = {};
+		v.Position = XMFLOAT3((i & 1) ? size : -size, (i & 2) ? size : -size, (i & 4) ? size : -size);
+		v.Normal = XMFLOAT3(0, 0, -1);
+		v.UV = XMFLOAT2((i & 1) ? 1.0f : 0.0f, (i & 2) ? 0.0f : 1.0f);
+		vertices.push_back(v);
+	}
+
+	unsigned int indices[] =
+	{
+		0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,
+		0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5,
+		0, 1, 5, 0, 5, 4,	2, 6, 7, 2, 7, 3,
+	};
+	return std::make_shared<Mesh>(vertices.data(), (int)vertices.size(), indices, 36, device);
+}
+
+bool TestScene::Create()
+{
+	D3D_FEATURE_LEVEL featureLevel;
+	if (FAILED(D3D11CreateDevice(0, D3D_DRIVER_TYPE_WARP, 0, 0, 0, 0, D3D11_SDK_VERSION,
+		device.GetAddressOf(), &featureLevel, context.GetAddressOf())))
+		return false;
+
+	// Color and depth targets
+	D3D11_TEXTURE2D_DESC targetDesc = {};
+	targetDesc.Width = 64;
+	targetDesc.Height = 64;
+	targetDesc.MipLevels = 1;
+	targetDesc.ArraySize = 1;
+	targetDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	targetDesc.SampleDesc.Count = 1;
+	targetDesc.Usage = D3D11_USAGE_DEFAULT;
+	targetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	ComPtr<ID3D11Texture2D> targetTexture;
+	device->CreateTexture2D(&targetDesc, 0, targetTexture.GetAddressOf());
+	device->CreateRenderTargetView(targetTexture.Get(), 0, renderTarget.GetAddressOf());
+
+	targetDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	targetDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	ComPtr<ID3D11Texture2D> depthTexture;
+	device->CreateTexture2D(&targetDesc, 0, depthTexture.GetAddressOf());
+	device->CreateDepthStencilView(depthTexture.Get(), 0, depthStencil.GetAddressOf());
+
+	context->OMSetRenderTargets(1, renderTarget.GetAddressOf(), depthStencil.Get());
+	D3D11_VIEWPORT viewport = { 0, 0, 64, 64, 0, 1 };
+	context->RSSetViewports(1, &viewport);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// A 1x1 texture (used as both diffuse and normal map) and a sampler
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = 1;
+	textureDesc.Height = 1;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	unsigned int texel = 0xFF8080FF;
+	D3D11_SUBRESOURCE_DATA textureData = { &texel, 4, 4 };
+	ComPtr<ID3D11Texture2D> textureResource;
+	device->CreateTexture2D(&textureDesc, &textureData, textureResource.GetAddressOf());
+	device->CreateShaderResourceView(textureResource.Get(), 0, texture.GetAddressOf());
+
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = samplerDesc.AddressV = samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&samplerDesc, sampler.GetAddressOf());
+
+	// The game's lit shaders, same features as Game::LoadShaders()
+	std::vector<ShaderFeature> vsFeatures = {
+		{ "NORMAL_MAP", MATERIAL_FEATURE_NORMAL_MAP },
+		{ "INSTANCED", MATERIAL_FEATURE_INSTANCED } };
+	std::vector<ShaderFeature> psFeatures = {
+		{ "NORMAL_MAP", MATERIAL_FEATURE_NORMAL_MAP },
+		{ "POINT_LIGHTS", MATERIAL_FEATURE_POINT_LIGHTS },
+		{ "FOG", MATERIAL_FEATURE_FOG } };
+	vertexShaders = std::make_shared<ShaderPermutations>(device, context, ShaderStage::Vertex,
+		SHADER_SOURCE_DIRECTORY L"VertexShader.hlsl", SHADER_OUTPUT_DIRECTORY L"VertexShader", vsFeatures);
+	pixelShaders = std::make_shared<ShaderPermutations>(device, context, ShaderStage::Pixel,
+		SHADER_SOURCE_DIRECTORY L"PixelShader.hlsl", SHADER_OUTPUT_DIRECTORY L"PixelShader", psFeatures);
+
+	materials.push_back(std::make_shared<Material>(XMFLOAT4(1, 0, 0, 1), 64.0f, texture, sampler,
+		vertexShaders, pixelShaders, 0));
+	materials.push_back(std::make_shared<Material>(XMFLOAT4(0, 1, 0, 1), 32.0f, texture, sampler,
+		vertexShaders, pixelShaders, 0, texture));
+	materials.push_back(std::make_shared<Material>(XMFLOAT4(0, 0, 1, 1), 16.0f, texture, sampler,
+		vertexShaders->GetVertexShader(0), pixelShaders->GetPixelShader(0)));
+
+	for (auto& material : materials)
+	{
+		if (!material->GetVertexShader() || !material->GetPixelShader())
+			return false;
+	}
+
+	meshes.push_back(MakeBoxMesh(device, 0.5f));
+	meshes.push_back(MakeBoxMesh(device, 0.25f));
+
+	// A few entities per (mesh, material) pair, in view
+	for (size_t m = 0; m < materials.size(); m++)
+	{
+		for (size_t g = 0; g < meshes.size(); g++)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				auto entity = std::make_unique<Entity>(meshes[g], materials[m]);
+				entity->GetTransform()->SetPosition(-3.0f + 2.0f * m, -1.0f + 2.0f * g, (float)i * 2.0f);
+				entities.push_back(std::move(entity));
+			}
+		}
+	}
+
+	camera = std::make_unique<Camera>(1.0f);
+	renderQueue = std::make_unique<RenderQueue>(device);
+
+	// Per-frame lighting data, as Game::SetGlobalPixelShaderInfo() sets it
+	PixelShaderExternalData psData = {};
+	psData.light.diffuseColor = XMFLOAT3(1, 1, 1);
+	psData.light.direction = XMFLOAT3(0, 0, 1);
+	psData.cameraPosition = camera->GetTransform()->GetPosition();
+	psData.fogStart = 100.0f;
+	psData.fogEnd = 200.0f;
+	for (auto& ps : pixelShaders->GetLoadedPixelShaders())
+		ps->SetStruct("ExternalData", psData);
+
+	return true;
+}
+
+void TestScene::DrawFrame()
+{
+	renderQueue->Begin(camera.get());
+	for (auto& entity : entities)
+		renderQueue->Submit(entity.get());
+	renderQueue->Execute(context.Get());
+}
+
+TEST(AllocationCounterSeesNew)
+{
+	allocationCount = 0;
+	countingAllocations = true;
+	int* value = new int(1);
+	float* values = new float[16];
+	countingAllocations = false;
+
+	CHECK(allocationCount == 2);
+	delete value;
+	delete[] values;
+}
+
+TEST(WarmFramesDontAllocate)
+{
+	TestScene scene;
+	bool created = scene.Create();
+	CHECK(created);
+	if (!created)
+		return;
+
+	D3D11_QUERY_DESC queryDesc = { D3D11_QUERY_PIPELINE_STATISTICS, 0 };
+	ComPtr<ID3D11Query> statistics;
+	scene.device->CreateQuery(&queryDesc, statistics.GetAddressOf());
+
+	for (int prePass = 0; prePass < 2; prePass++)
+	{
+		scene.renderQueue->SetDepthPrePass(prePass != 0);
+
+		// The first frames grow the queue's buffers
+		scene.DrawFrame();
+		scene.DrawFrame();
+
+		scene.context->Begin(statistics.Get());
+		allocationCount = 0;
+		countingAllocations = true;
+		scene.DrawFrame();
+		countingAllocations = false;
+		scene.context->End(statistics.Get());
+
+		if (allocationCount != 0)
+			printf("  %d allocation(s) with the pre-pass %s\n", allocationCount.load(), prePass ? "on" : "off");
+		CHECK(allocationCount == 0);
+
+		// Everything was submitted and actually drawn
+		CHECK(scene.renderQueue->GetPacketCount() == scene.entities.size());
+		CHECK(scene.renderQueue->GetCulledCount() == 0);
+
+		D3D11_QUERY_DATA_PIPELINE_STATISTICS stats = {};
+		while (scene.context->GetData(statistics.Get(), &stats, sizeof(stats), 0) == S_FALSE)
+			;
+		CHECK(stats.IAPrimitives >= scene.entities.size() * 12);
+	}
+}
@@ -0,0 +1,327 @@
+#include "TestFramework.h"
+#include "ShaderReflectionData.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Raw D3D enum values, as stored in the reflection data
+static const uint32_t D3D_SIT_CBUFFER = 0;
+static const uint32_t D3D_SIT_TEXTURE = 2;
+static const uint32_t D3D_SIT_SAMPLER = 3;
+static const uint32_t D3D_REGISTER_COMPONENT_FLOAT32 = 3;
+
+// Header layout (see ShaderReflectionData.cpp): magic, version,
+// content hash, payload size
+static const size_t VersionOffset = 4;
+static const size_t HashOffset = 8;
+static const size_t PayloadSizeOffset = 16;
+static const size_t HeaderSize = 20;
+
+static void PatchU32(std::vector<unsigned char>& bytes, size_t offset, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		bytes[offset + i] = (unsigned char)(value >> (i * 8));
+}
+
+static bool IsCleared(const ShaderReflectionData& data)
+{
+	return data.ConstantBuffers.empty() && data.Resources.empty() &&
+		data.InputParameters.empty() && data.OutputParameters.empty() &&
+		data.ThreadsX == 0 && data.ThreadsY == 0 && data.ThreadsZ == 0;
+}
+
+// Deserializes into data that already holds something, so a
+// failure has to actively clear it
+static bool Deserialize(const std::vector<unsigned char>& bytes, size_t size, uint64_t hash, ShaderReflectionData& out)
+{
+	out.ConstantBuffers.push_back({ "Stale", 16, 0, {} });
+	out.ThreadsX = 7;
+	return ShaderReflectionSerializer::Deserialize(bytes.data(), size, hash, out);
+}
+
+static bool SameParameters(const std::vector<ShaderReflectionParameter>& a, const std::vector<ShaderReflectionParameter>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].SemanticName != b[i].SemanticName || a[i].SemanticIndex != b[i].SemanticIndex ||
+			a[i].Register != b[i].Register || a[i].ComponentType != b[i].ComponentType ||
+			a[i].Mask != b[i].Mask || a[i].Stream != b[i].Stream)
+			return false;
+	}
+	return true;
+}
+
+// Field by field, reporting the first difference in each part
+static void CheckSame(const ShaderReflectionData& actual, const ShaderReflectionData& expected)
+{
+	CHECK(actual.ConstantBuffers.size() == expected.ConstantBuffers.size());
+	for (size_t b = 0; b < actual.ConstantBuffers.size() && b < expected.ConstantBuffers.size(); b++)
+	{
+		const ShaderReflectionBuffer& a = actual.ConstantBuffers[b];
+		const ShaderReflectionBuffer& e = expected.ConstantBuffers[b];
+		CHECK(a.Name == e.Name);
+		CHECK(a.Size == e.Size);
+		CHECK(a.BindIndex == e.BindIndex);
+		CHECK(a.Variables.size() == e.Variables.size());
+		for (size_t v = 0; v < a.Variables.size() && v < e.Variables.size(); v++)
+		{
+			CHECK(a.Variables[v].Name == e.Variables[v].Name);
+			CHECK(a.Variables[v].ByteOffset == e.Variables[v].ByteOffset);
+			CHECK(a.Variables[v].Size == e.Variables[v].Size);
+		}
+	}
+
+	CHECK(actual.Resources.size() == expected.Resources.size());
+	for (size_t r = 0; r < actual.Resources.size() && r < expected.Resources.size(); r++)
+	{
+		CHECK(actual.Resources[r].Name == expected.Resources[r].Name);
+		CHECK(actual.Resources[r].Type == expected.Resources[r].Type);
+		CHECK(actual.Resources[r].BindIndex == expected.Resources[r].BindIndex);
+	}
+
+	CHECK(SameParameters(actual.InputParameters, expected.InputParameters));
+	CHECK(SameParameters(actual.OutputParameters, expected.OutputParameters));
+	CHECK(actual.ThreadsX == expected.ThreadsX);
+	CHECK(actual.ThreadsY == expected.ThreadsY);
+	CHECK(actual.ThreadsZ == expected.ThreadsZ);
+}
+
+// --------------------------------------------------------
+// Reflection of PixelShader_1.cso (PixelShader.hlsl with
+// NORMAL_MAP), as recorded in Tests/Reflection
+// --------------------------------------------------------
+static const uint64_t PixelShaderHash = 0x9A3C5E71D2B40F68ull;
+
+static ShaderReflectionData MakePixelShaderReflection()
+{
+	ShaderReflectionData data;
+	data.ConstantBuffers.push_back({ "ExternalData", 208, 0, {
+		{ "light", 0, 48 },
+		{ "light2", 48, 48 },
+		{ "light3", 96, 48 },
+		{ "reflectivity", 144, 4 },
+		{ "cameraPosition", 148, 12 },
+		{ "fogColor", 160, 12 },
+		{ "fogStart", 172, 4 },
+		{ "fogEnd", 176, 4 },
+		{ "clusterTileScale", 180, 8 },
+		{ "clusterSliceScale", 188, 4 },
+		{ "clusterSliceBias", 192, 4 },
+		{ "clusterCounts", 196, 12 } } });
+
+	data.Resources = {
+		{ "samplerOptions", D3D_SIT_SAMPLER, 0 },
+		{ "diffuseTexture", D3D_SIT_TEXTURE, 0 },
+		{ "normalMap", D3D_SIT_TEXTURE, 1 },
+		{ "ExternalData", D3D_SIT_CBUFFER, 0 } };
+
+	data.InputParameters = {
+		{ "SV_POSITION", 0, 0, D3D_REGISTER_COMPONENT_FLOAT32, 0xF, 0 },
+		{ "COLOR", 0, 1, D3D_REGISTER_COMPONENT_FLOAT32, 0xF, 0 },
+		{ "NORMAL", 0, 2, D3D_REGISTER_COMPONENT_FLOAT32, 0x7, 0 },
+		{ "POSITION", 0, 3, D3D_REGISTER_COMPONENT_FLOAT32, 0x7, 0 },
+		{ "TEXCOORD", 0, 4, D3D_REGISTER_COMPONENT_FLOAT32, 0x3, 0 },
+		{ "TANGENT", 0, 5, D3D_REGISTER_COMPONENT_FLOAT32, 0x7, 0 } };
+
+	data.OutputParameters = {
+		{ "SV_TARGET", 0, 0, D3D_REGISTER_COMPONENT_FLOAT32, 0xF, 0 } };
+	return data;
+}
+
+static std::vector<unsigned char> LoadFixture(const char* name)
+{
+	std::ifstream file(std::string(REFLECTION_DIRECTORY) + name, std::ios::binary);
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Something with every kind of field, including a compute
+// shader's thread counts
+static ShaderReflectionData MakeEverything()
+{
+	ShaderReflectionData data = MakePixelShaderReflection();
+	data.ConstantBuffers.push_back({ "Second", 32, 3, { { "a", 0, 16 }, { "", 16, 16 } } });
+	data.Resources.push_back({ "outputTexture", 4, 2 });
+	data.OutputParameters.push_back({ "SV_TARGET", 1, 1, 1, 0x1, 2 });
+	data.ThreadsX = 8;
+	data.ThreadsY = 4;
+	data.ThreadsZ = 1;
+	return data;
+}
+
+TEST(HashBytesIsFnv1a64)
+{
+	CHECK(ShaderReflectionSerializer::HashBytes("", 0) == 0xCBF29CE484222325ull);
+	CHECK(ShaderReflectionSerializer::HashBytes("a", 1) == 0xAF63DC4C8601EC8Cull);
+	CHECK(ShaderReflectionSerializer::HashBytes("foobar", 6) == 0x85944171F73967E8ull);
+
+	unsigned char zero = 0;
+	CHECK(ShaderReflectionSerializer::HashBytes(&zero, 1) == 0xAF63BD4C8601B7DFull);
+}
+
+TEST(RoundTripKeepsEveryField)
+{
+	ShaderReflectionData original = MakeEverything();
+	std::vector<unsigned char> bytes;
+	ShaderReflectionSerializer::Serialize(original, 42, bytes);
+
+	ShaderReflectionData loaded;
+	CHECK(Deserialize(bytes, bytes.size(), 42, loaded));
+	CheckSame(loaded, original);
+
+	// And an empty shader
+	ShaderReflectionSerializer::Serialize(ShaderReflectionData(), 0, bytes);
+	CHECK(bytes.size() == HeaderSize + 4 * 7);
+	CHECK(Deserialize(bytes, bytes.size(), 0, loaded));
+	CHECK(IsCleared(loaded));
+}
+
+TEST(RecordedPixelShaderCacheDecodes)
+{
+	std::vector<unsigned char> bytes = LoadFixture("PixelShader_1.cso.refl");
+	CHECK(!bytes.empty());
+
+	ShaderReflectionData loaded;
+	CHECK(Deserialize(bytes, bytes.size(), PixelShaderHash, loaded));
+	CheckSame(loaded, MakePixelShaderReflection());
+
+	// The format hasn't changed since it was recorded
+	std::vector<unsigned char> written;
+	ShaderReflectionSerializer::Serialize(MakePixelShaderReflection(), PixelShaderHash, written);
+	CHECK(written == bytes);
+}
+
+TEST(TruncatedCachesAreRejected)
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionSerializer::Serialize(MakeEverything(), 42, bytes);
+
+	int accepted = 0;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		ShaderReflectionData loaded;
+		if (Deserialize(bytes, size, 42, loaded) || !IsCleared(loaded))
+			accepted++;
+	}
+	CHECK(accepted == 0);
+
+	ShaderReflectionData loaded;
+	CHECK(!ShaderReflectionSerializer::Deserialize(nullptr, 0, 42, loaded));
+}
+
+TEST(WrongHeadersAreRejected)
+{
+	std::vector<unsigned char> good;
+	ShaderReflectionSerializer::Serialize(MakeEverything(), 42, good);
+	ShaderReflectionData loaded;
+
+	std::vector<unsigned char> bytes = good;
+	bytes[0] ^= 0xFF;
+	CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+	CHECK(IsCleared(loaded));
+
+	bytes = good;
+	PatchU32(bytes, VersionOffset, 2);
+	CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+	CHECK(IsCleared(loaded));
+
+	// A cache for other shader code
+	CHECK(!Deserialize(good, good.size(), 43, loaded));
+	CHECK(IsCleared(loaded));
+	bytes = good;
+	bytes[HashOffset + 7] ^= 0x80;
+	CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+	CHECK(IsCleared(loaded));
+}
+
+TEST(PayloadSizeMustMatchTheBytesLeft)
+{
+	std::vector<unsigned char> good;
+	ShaderReflectionSerializer::Serialize(MakeEverything(), 42, good);
+	uint32_t payloadSize = (uint32_t)(good.size() - HeaderSize);
+	ShaderReflectionData loaded;
+
+	for (uint32_t wrongSize : { payloadSize - 1, payloadSize + 1, 0u, 0xFFFFFFFFu })
+	{
+		std::vector<unsigned char> bytes = good;
+		PatchU32(bytes, PayloadSizeOffset, wrongSize);
+		CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+		CHECK(IsCleared(loaded));
+	}
+}
+
+TEST(TrailingBytesAreRejected)
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionSerializer::Serialize(MakeEverything(), 42, bytes);
+	bytes.push_back(0);
+	ShaderReflectionData loaded;
+
+	// With the payload size left alone...
+	CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+	CHECK(IsCleared(loaded));
+
+	// ...and with it covering the extra byte
+	PatchU32(bytes, PayloadSizeOffset, (uint32_t)(bytes.size() - HeaderSize));
+	CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+	CHECK(IsCleared(loaded));
+}
+
+TEST(CountsLargerThanTheBytesLeftAreRejected)
+{
+	ShaderReflectionData data;
+	data.ConstantBuffers.push_back({ "Only", 16, 0, { { "v", 0, 16 } } });
+	std::vector<unsigned char> good;
+	ShaderReflectionSerializer::Serialize(data, 42, good);
+	ShaderReflectionData loaded;
+
+	// Payload: buffer count, then the buffer's name (length +
+	// "Only"), size, bind index and variable count
+	size_t bufferCountOffset = HeaderSize;
+	size_t variableCountOffset = HeaderSize + 4 + 4 + 4 + 4 + 4;
+	size_t resourceCountOffset = good.size() - 4 * 6;
+
+	for (size_t offset : { bufferCountOffset, variableCountOffset, resourceCountOffset })
+	{
+		for (uint32_t count : { 1000u, 0xFFFFFFFFu })
+		{
+			std::vector<unsigned char> bytes = good;
+			PatchU32(bytes, offset, count);
+			CHECK(!Deserialize(bytes, bytes.size(), 42, loaded));
+			CHECK(IsCleared(loaded));
+		}
+	}
+
+	// The unpatched cache is fine
+	CHECK(Deserialize(good, good.size(), 42, loaded));
+}
+
+TEST(VariablesOutsideTheirBufferAreRejected)
+{
+	ShaderReflectionData loaded;
+	std::vector<unsigned char> bytes;
+	struct { uint32_t Offset, Size; bool Valid; } cases[] =
+	{
+		{ 0, 64, true },
+		{ 48, 16, true },
+		{ 64, 0, true },
+		{ 48, 17, false },
+		{ 60, 8, false },
+		{ 65, 0, false },
+		{ 0xFFFFFFF0u, 0x20, false },	// Offset + size wraps around
+	};
+
+	for (auto& test : cases)
+	{
+		ShaderReflectionData data;
+		data.ConstantBuffers.push_back({ "Buffer", 64, 0, { { "v", test.Offset, test.Size } } });
+		ShaderReflectionSerializer::Serialize(data, 42, bytes);
+		CHECK(Deserialize(bytes, bytes.size(), 42, loaded) == test.Valid);
+		if (!test.Valid)
+			CHECK(IsCleared(loaded));
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// A minimal harness for testing the classes that don't need
+// D3D.  TEST() registers a function, CHECK() / CHECK_NEAR()
+// report a failure and carry on, and TestMain.cpp runs every
+// registered test, returning nonzero if any check failed.
+// --------------------------------------------------------
+struct TestCase
+{
+	const char* Name;
+	void (*Run)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportFailure(const char* file, int line, const char* expression);
+void ReportNearFailure(const char* file, int line, const char* expression, double actual, double expected, double tolerance);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*run)()) { GetTestCases().push_back({ name, run }); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do \
+	{ \
+		double checkActual = (double)(actual), checkExpected = (double)(expected); \
+		if (!(std::fabs(checkActual - checkExpected) <= (tolerance))) \
+			ReportNearFailure(__FILE__, __LINE__, #actual, checkActual, checkExpected, (tolerance)); \
+	} while (0)
@@ -0,0 +1,53 @@
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+
+static int failureCount = 0;
+
+std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	failureCount++;
+}
+
+void ReportNearFailure(const char* file, int line, const char* expression, double actual, double expected, double tolerance)
+{
+	printf("  %s(%d): %s is %.9g, expected %.9g (+/- %g)\n", file, line, expression, actual, expected, tolerance);
+	failureCount++;
+}
+
+// --------------------------------------------------------
+// Runs every test (or just those whose names contain the
+// first argument)
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : 0;
+
+	int run = 0;
+	int failedTests = 0;
+	for (const TestCase& test : GetTestCases())
+	{
+		if (filter && !strstr(test.Name, filter))
+			continue;
+
+		int failuresBefore = failureCount;
+		test.Run();
+		run++;
+
+		bool passed = failureCount == failuresBefore;
+		if (!passed)
+			failedTests++;
+		printf("%s %s\n", passed ? "[ PASS ]" : "[ FAIL ]", test.Name);
+	}
+
+	printf("%d of %d tests passed\n", run - failedTests, run);
+	return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include "ThreadPool.h"
+
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	activeJobs = 0;
+	shuttingDown = false;
+
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+// Finishes any queued jobs, then joins the workers
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shuttingDown = true;
+	}
+	jobAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	allIdle.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	// Every helper pulls indices from one counter, so it doesn't
+	// matter how many workers actually pick up a job.  Shared so
+	// a helper that starts after we return finds nothing to do
+	struct Progress
+	{
+		std::atomic<size_t> next;
+		std::atomic<size_t> finished;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<Progress> progress = std::make_shared<Progress>();
+	progress->next = 0;
+	progress->finished = 0;
+
+	auto run = [progress, count, &body]()
+	{
+		size_t index;
+		while ((index = progress->next++) < count)
+		{
+			body(index);
+			if (++progress->finished == count)
+			{
+				std::lock_guard<std::mutex> lock(progress->mutex);
+				progress->done.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = count - 1 < workers.size() ? count - 1 : workers.size();
+	for (size_t i = 0; i < helpers; i++)
+		Enqueue(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(progress->mutex);
+	progress->done.wait(lock, [&] { return progress->finished == count; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return shuttingDown || !jobs.empty(); });
+
+			// Only stop once the queue has drained
+			if (jobs.empty())
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			activeJobs++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeJobs--;
+			if (jobs.empty() && activeJobs == 0)
+				allIdle.notify_all();
+		}
+	}
+}
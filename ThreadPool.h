@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed set of worker threads pulling jobs off one queue.
+// Jobs must not touch the D3D immediate context - anything
+// that does has to be handed back to the main thread.
+// --------------------------------------------------------
+class ThreadPool
+{
+public:
+	// threadCount of 0 picks one less than the number of
+	// hardware threads (leaving a core for the main thread)
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	void Enqueue(std::function<void()> job);
+
+	// Blocks until the queue is empty and every worker is idle
+	void Wait();
+
+	// Runs body(0) .. body(count - 1) across the workers and the
+	// calling thread, returning once they've all finished.  Only
+	// waits for its own work, not anything else queued
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	unsigned int GetThreadCount() { return (unsigned int)workers.size(); }
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	unsigned int activeJobs;
+	bool shuttingDown;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable allIdle;
+
+	void WorkerLoop();
+};
@@ -13,18 +13,21 @@ void Transform::SetPosition(float x, float y, float z)
 {
 	position = XMFLOAT3(x, y, z);
 	worldDirty = true;
+	interpolatedDirty = true;
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
 	rotation = XMFLOAT3(pitch, yaw, roll);
 	worldDirty = true;
+	interpolatedDirty = true;
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
 	scale = XMFLOAT3(x, y, z);
 	worldDirty = true;
+	interpolatedDirty = true;
 }
 
 XMFLOAT3 Transform::GetPosition() const
@@ -61,6 +64,7 @@ void Transform::MoveAbsolute(float x, float y, float z)
 	pos += move;
 	XMStoreFloat3(&position, pos);
 	worldDirty = true;
+	interpolatedDirty = true;
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -74,6 +78,7 @@ void Transform::MoveRelative(float x, float y, float z)
 
 	XMStoreFloat3(&position, pos);
 	worldDirty = true;
+	interpolatedDirty = true;
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
@@ -83,6 +88,7 @@ void Transform::Rotate(float pitch, float yaw, float roll)
 	rot += change;
 	XMStoreFloat3(&rotation, rot);
 	worldDirty = true;
+	interpolatedDirty = true;
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -92,6 +98,44 @@ void Transform::Scale(float x, float y, float z)
 	scaleVec *= change;
 	XMStoreFloat3(&scale, scaleVec);
 	worldDirty = true;
+	interpolatedDirty = true;
+}
+
+void Transform::StorePreviousState()
+{
+	previousPosition = position;
+	previousRotation = rotation;
+	previousScale = scale;
+	hasPreviousState = true;
+	interpolatedDirty = true;
+}
+
+XMFLOAT4X4 Transform::GetInterpolatedWorldMatrix(float alpha)
+{
+	// New this tick (nothing to blend from) or fully current
+	if (!hasPreviousState || alpha >= 1.0f)
+		return GetWorldMatrix();
+
+	if (!interpolatedDirty && alpha == interpolatedAlpha)
+		return interpolatedMatrix;
+
+	// Blend rotations as quaternions, so they take the short way round
+	XMVECTOR blendedPosition = XMVectorLerp(XMLoadFloat3(&previousPosition), XMLoadFloat3(&position), alpha);
+	XMVECTOR blendedScale = XMVectorLerp(XMLoadFloat3(&previousScale), XMLoadFloat3(&scale), alpha);
+	XMVECTOR blendedRotation = XMQuaternionSlerp(
+		XMQuaternionRotationRollPitchYaw(previousRotation.x, previousRotation.y, previousRotation.z),
+		XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z),
+		alpha);
+
+	XMMATRIX world =
+		XMMatrixScalingFromVector(blendedScale) *
+		XMMatrixRotationQuaternion(blendedRotation) *
+		XMMatrixTranslationFromVector(blendedPosition);
+
+	XMStoreFloat4x4(&interpolatedMatrix, world);
+	interpolatedAlpha = alpha;
+	interpolatedDirty = false;
+	return interpolatedMatrix;
 }
 
 void Transform::RecalculateWorldMatrix()
@@ -19,6 +19,12 @@ public:
 	void Rotate(float pitch, float yaw, float roll);
 	void Scale(float x, float y, float z);
 
+	// For rendering between fixed simulation ticks: remember the
+	// state at the start of a tick, then blend from it to the
+	// current state (alpha 0 is the previous state, 1 the current)
+	void StorePreviousState();
+	DirectX::XMFLOAT4X4 GetInterpolatedWorldMatrix(float alpha);
+
 private:
 	bool worldDirty = false;
 	DirectX::XMFLOAT4X4 worldMatrix;
@@ -27,6 +33,15 @@ private:
 	DirectX::XMFLOAT3 rotation;
 	DirectX::XMFLOAT3 scale;
 
+	// Start of the current tick, and the last blend of it
+	bool hasPreviousState = false;
+	DirectX::XMFLOAT3 previousPosition;
+	DirectX::XMFLOAT3 previousRotation;
+	DirectX::XMFLOAT3 previousScale;
+	bool interpolatedDirty = true;
+	float interpolatedAlpha = 0;
+	DirectX::XMFLOAT4X4 interpolatedMatrix;
+
 	void RecalculateWorldMatrix();
 };
 
@@ -0,0 +1,119 @@
+#include "Velocity.hlsli"
+
+// Each effect is on when its define is 1 (see PostProcessStack)
+#ifndef MOTION_BLUR
+#define MOTION_BLUR 0
+#endif
+#ifndef TONEMAP
+#define TONEMAP 0
+#endif
+#ifndef COLOR_GRADING
+#define COLOR_GRADING 0
+#endif
+#ifndef VIGNETTE
+#define VIGNETTE 0
+#endif
+
+cbuffer externalData : register(b0)
+{
+	float2 screenSize;
+	float2 uvScale;			// Part of "pixels" to use (dynamic resolution)
+	float2 renderScale;		// Depth buffer pixels per screen pixel
+
+	// Motion blur
+	matrix inverseViewProjection;
+	matrix previousViewProjection;
+	int tileSize;
+	int sampleCount;
+	float maxBlurPixels;	// Longest streak, so fast turns don't smear everything
+
+	// Tonemapping
+	float exposure;
+
+	// Color grading
+	float saturation;
+	float contrast;
+	float3 colorFilter;
+
+	// Vignette
+	float vignetteStrength;
+	float vignetteRadius;
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D pixels			: register(t0);	// The scene, or the blurred scene (any size)
+Texture2D depthBuffer		: register(t1);
+Texture2D velocityTiles		: register(t2);	// From VelocityTilesPS
+SamplerState samplerOptions	: register(s0);
+
+// Smears the pixel along the path its surface took across
+// the screen since last frame
+float3 MotionBlur(VertexToPixel input)
+{
+	int2 pixel = int2(input.position.xy);
+
+	// Nothing in this tile moved as much as half a pixel
+	float2 tileVelocity = velocityTiles.Load(int3(pixel / tileSize, 0)).xy;
+	if (dot(tileVelocity, tileVelocity) < 0.25f)
+		return pixels.Sample(samplerOptions, input.uv * uvScale).rgb;
+
+	float depth = depthBuffer.Load(int3(input.position.xy * renderScale, 0)).r;
+	float2 velocity = CameraVelocity(input.uv, depth, inverseViewProjection, previousViewProjection) * screenSize;
+
+	float velocityLength = length(velocity);
+	if (velocityLength > maxBlurPixels)
+		velocity *= maxBlurPixels / velocityLength;
+	velocity /= screenSize;
+
+	// Samples centered on the pixel, from half a frame
+	// behind to half a frame ahead
+	float3 totalColor = float3(0, 0, 0);
+	for (int i = 0; i < sampleCount; i++)
+	{
+		float t = i / (float)(sampleCount - 1) - 0.5f;
+		totalColor += pixels.Sample(samplerOptions, (input.uv + velocity * t) * uvScale).rgb;
+	}
+
+	return totalColor / sampleCount;
+}
+
+// Filmic curve (Narkowicz's fit of the ACES curve)
+float3 Tonemap(float3 color)
+{
+	return saturate((color * (2.51f * color + 0.03f)) / (color * (2.43f * color + 0.59f) + 0.14f));
+}
+
+// Every enabled effect, in one pass
+float4 main(VertexToPixel input) : SV_TARGET
+{
+#if MOTION_BLUR
+	float3 color = MotionBlur(input);
+#else
+	float3 color = pixels.Sample(samplerOptions, input.uv * uvScale).rgb;
+#endif
+
+#if TONEMAP
+	color = Tonemap(color * exposure);
+#endif
+
+#if COLOR_GRADING
+	float luminance = dot(color, float3(0.2126f, 0.7152f, 0.0722f));
+	color = lerp(luminance.xxx, color, saturation);
+	color = (color - 0.5f) * contrast + 0.5f;
+	color *= colorFilter;
+#endif
+
+#if VIGNETTE
+	float2 fromCenter = (input.uv - 0.5f) * float2(screenSize.x / screenSize.y, 1);
+	color *= 1 - vignetteStrength * smoothstep(vignetteRadius, vignetteRadius + 0.5f, length(fromCenter));
+#endif
+
+	return float4(saturate(color), 1);
+}
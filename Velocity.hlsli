@@ -0,0 +1,22 @@
+#ifndef __GGP_VELOCITY__
+#define __GGP_VELOCITY__
+
+// --------------------------------------------------------
+// How far a pixel's surface moved on screen since last frame,
+// due to the camera alone (the surface itself is assumed to
+// be still).  Rebuilds the world position from depth, then
+// projects it with last frame's view-projection.  Returns
+// the current UV minus the previous one
+// --------------------------------------------------------
+float2 CameraVelocity(float2 uv, float depth, matrix inverseViewProjection, matrix previousViewProjection)
+{
+	float4 clipPos = float4(uv.x * 2 - 1, 1 - uv.y * 2, depth, 1);
+	float4 worldPos = mul(inverseViewProjection, clipPos);
+	worldPos /= worldPos.w;
+
+	float4 previousPos = mul(previousViewProjection, worldPos);
+	float2 previousUV = float2(previousPos.x, -previousPos.y) / previousPos.w * 0.5f + 0.5f;
+	return uv - previousUV;
+}
+
+#endif
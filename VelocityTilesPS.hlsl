@@ -0,0 +1,48 @@
+#include "Velocity.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	matrix inverseViewProjection;
+	matrix previousViewProjection;
+	float2 screenSize;
+	float2 renderScale;		// Depth buffer pixels per screen pixel (dynamic resolution)
+	int tileSize;
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D depthBuffer		: register(t0);
+
+// One pixel per tile of the screen: the largest camera
+// velocity (in pixels) of any pixel in the tile, so the
+// motion blur can skip tiles that barely moved
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	int2 tileStart = int2(input.position.xy) * tileSize;
+	float2 maxVelocity = float2(0, 0);
+
+	for (int y = 0; y < tileSize; y++)
+	{
+		for (int x = 0; x < tileSize; x++)
+		{
+			int2 pixel = tileStart + int2(x, y);
+			if (pixel.x >= screenSize.x || pixel.y >= screenSize.y)
+				continue;
+
+			float2 uv = (pixel + 0.5f) / screenSize;
+			float depth = depthBuffer.Load(int3((pixel + 0.5f) * renderScale, 0)).r;
+			float2 velocity = CameraVelocity(uv, depth, inverseViewProjection, previousViewProjection) * screenSize;
+
+			if (dot(velocity, velocity) > dot(maxVelocity, maxVelocity))
+				maxVelocity = velocity;
+		}
+	}
+
+	return float4(maxVelocity, 0, 0);
+}
@@ -1,11 +1,57 @@
-#include<ShaderEverything.hlsli>
+#include "ShaderEverything.hlsli"
+
+// Feature defines, set per variant by ShaderPermutations
+// (see Game::LoadShaders).  Off when built by the project.
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+
+#if NORMAL_MAP
+#define VERTEX_OUTPUT VertexToPixelNormalMap
+#else
+#define VERTEX_OUTPUT VertexToPixel
+#endif
+
+#if INSTANCED
+// Per vertex data plus per instance data from input slot 1
+// (see InstanceData in RenderQueue.h).  Each matrix arrives
+// as the rows of the C++ matrix
+struct InstancedVertexShaderInput
+{
+	float3 position		: POSITION;
+	float3 normal		: NORMAL;
+	float2 uv			: TEXCOORD;
+	float3 tangent		: TANGENT;
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+	float4 worldIT0		: WORLDIT_PER_INSTANCE0;
+	float4 worldIT1		: WORLDIT_PER_INSTANCE1;
+	float4 worldIT2		: WORLDIT_PER_INSTANCE2;
+	float4 worldIT3		: WORLDIT_PER_INSTANCE3;
+	float4 wvp0			: WVP_PER_INSTANCE0;
+	float4 wvp1			: WVP_PER_INSTANCE1;
+	float4 wvp2			: WVP_PER_INSTANCE2;
+	float4 wvp3			: WVP_PER_INSTANCE3;
+	float4 tint			: COLOR_PER_INSTANCE;
+};
+#define VERTEX_INPUT InstancedVertexShaderInput
+#else
+// All matrices are computed on the CPU once per object
+// (see RenderQueue::ComputeObjectData)
 cbuffer ExternalData : register(b0)
 { 
 	float4 colorTint; 
 	float4x4 worldMatrix; 
-	float4x4 projectionMatrix;
-	float4x4 viewMatrix;
+	float4x4 worldInverseTransposeMatrix;
+	float4x4 worldViewProjectionMatrix;
 }
+#define VERTEX_INPUT VertexShaderInput
+#endif
 
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
@@ -14,10 +60,23 @@ cbuffer ExternalData : register(b0)
 // - Output is a single struct of data to pass down the pipeline
 // - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
-VertexToPixel main( VertexShaderInput input )
+VERTEX_OUTPUT main( VERTEX_INPUT input )
 {
 	// Set up output struct
-	VertexToPixel output;
+	VERTEX_OUTPUT output;
+
+#if INSTANCED
+	// Transposed to match how the constant buffer matrices are read
+	float4x4 world = transpose(float4x4(input.world0, input.world1, input.world2, input.world3));
+	float4x4 worldIT = transpose(float4x4(input.worldIT0, input.worldIT1, input.worldIT2, input.worldIT3));
+	float4x4 wvp = transpose(float4x4(input.wvp0, input.wvp1, input.wvp2, input.wvp3));
+	float4 tint = input.tint;
+#else
+	float4x4 world = worldMatrix;
+	float4x4 worldIT = worldInverseTransposeMatrix;
+	float4x4 wvp = worldViewProjectionMatrix;
+	float4 tint = colorTint;
+#endif
 
 	// Here we're essentially passing the input position directly through to the next
 	// stage (rasterizer), though it needs to be a 4-component vector now.  
@@ -27,19 +86,23 @@ VertexToPixel main( VertexShaderInput input )
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in future assignments).
-	matrix wvp = mul(projectionMatrix, mul(viewMatrix, worldMatrix));
 	output.position = mul(wvp, float4(input.position, 1.0f));
 
-	output.worldPos = mul(worldMatrix, float4(input.position, 1.0f)).xyz;
+	output.worldPos = mul(world, float4(input.position, 1.0f)).xyz;
 
 	// Pass the color through 
 	// - The values will be interpolated per-pixel by the rasterizer
 	// - We don't need to alter it here, but we do need to send it to the pixel shader
-	output.color = colorTint;
+	output.color = tint;
+
+	// Normals use the inverse transpose so non-uniform scale
+	// doesn't skew them; tangents lie in the surface, so they
+	// transform like positions
+	output.normal = mul((float3x3)worldIT, input.normal);
 
-	//transform normal ignoring translation
-	//TODO Make world the inverse transpose of world (calculate in C++ and pass in as constant buffer)
-	output.normal = mul((float3x3)worldMatrix, input.normal);
+#if NORMAL_MAP
+	output.tangent = mul((float3x3)world, input.tangent);
+#endif
 
 	output.uv = input.uv;
 	// Whatever we return will make its way through the pipeline to the